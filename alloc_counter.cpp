@@ -0,0 +1,52 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> bytes(0);
+static std::atomic<uint64_t> deallocations(0);
+
+uint64_t allocation_count() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t allocated_bytes() {
+	return bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t deallocation_count() {
+	return deallocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory != nullptr)
+		deallocations.fetch_add(1, std::memory_order_relaxed);
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	operator delete(memory);
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+// counts every global operator new in the program, so benchmarks and soak runs can tell whether a hot path allocates.
+// only works in programs that link alloc_counter.cpp, everywhere else allocation_count() stays 0
+
+uint64_t allocation_count();
+uint64_t allocated_bytes();
+uint64_t deallocation_count(); // allocation_count() minus this is how many are still alive
\ No newline at end of file
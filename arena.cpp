@@ -0,0 +1,115 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "arena.h"
+#include "thread_pool.h"
+
+// runs the arena without a window: hundreds or thousands of ai sneks on one board, their decisions spread over a thread pool.
+// prints snek-steps per second and a checksum of the final board, which has to come out the same for any --threads.
+// "--sweep" runs the same arena on 1, 2, 4, ... threads and finally --threads and checks exactly that, e.g.
+// "snek_arena --sneks 2000 --board 1000x1000 --steps 2000 --sweep"
+
+struct ArenaResult {
+	double seconds = 0.0;
+	uint64_t checksum = 0;
+	uint64_t snek_steps = 0;
+	uint64_t deaths = 0;
+	uint64_t foods_eaten = 0;
+};
+
+static ArenaResult run_arena(int width, int height, size_t snek_count, size_t food_count, uint64_t steps, uint64_t seed, unsigned int threads) {
+	ThreadPool pool(threads);
+	ArenaEngine arena;
+	arena.reset(width, height, snek_count, food_count, seed);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t s = 0; s < steps; s++)
+		arena.step(pool);
+
+	ArenaResult result;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.checksum = arena.checksum();
+	result.snek_steps = arena.snek_steps;
+	result.deaths = arena.deaths;
+	result.foods_eaten = arena.foods_eaten;
+	return result;
+}
+
+static void print_result(unsigned int threads, const ArenaResult& result) {
+	double rate = result.snek_steps / (result.seconds > 0 ? result.seconds : 1e-9);
+	printf("threads: %u, %.3f s, %.0f snek-steps/s, deaths: %llu, foods eaten: %llu, checksum: %016llx\n", threads, result.seconds, rate,
+		(unsigned long long)result.deaths, (unsigned long long)result.foods_eaten, (unsigned long long)result.checksum);
+}
+
+int main(int argc, char* argv[]) {
+	int width = 1000, height = 1000;
+	size_t snek_count = 1000;
+	size_t food_count = 0; // 0 means half as many as there are sneks
+	uint64_t steps = 1000;
+	uint64_t seed = 1;
+	unsigned int threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+	bool sweep = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--sneks") == 0 && i + 1 < argc)
+			snek_count = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--foods") == 0 && i + 1 < argc)
+			food_count = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+			steps = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			threads = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--sweep") == 0)
+			sweep = true;
+		else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 2 || height < 2) {
+				std::cerr << "--board expects WIDTHxHEIGHT, e.g. 1000x1000" << std::endl;
+				return 1;
+			}
+		}
+		else {
+			std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+			return 1;
+		}
+	}
+
+	if (food_count == 0)
+		food_count = snek_count / 2 > 0 ? snek_count / 2 : 1;
+	if (threads == 0)
+		threads = 1;
+	if (snek_count + food_count > (size_t)width * height / 2) {
+		std::cerr << "too many sneks and foods for a " << width << "x" << height << " board" << std::endl;
+		return 1;
+	}
+
+	std::cout << "board: " << width << "x" << height << ", sneks: " << snek_count << ", foods: " << food_count
+		<< ", steps: " << steps << ", seed: " << seed << std::endl;
+
+	if (!sweep) {
+		print_result(threads, run_arena(width, height, snek_count, food_count, steps, seed, threads));
+		return 0;
+	}
+
+	ArenaResult single = run_arena(width, height, snek_count, food_count, steps, seed, 1);
+	print_result(1, single);
+
+	bool same = true;
+	for (unsigned int t = 2; t <= threads; t = (t < threads && t * 2 > threads) ? threads : t * 2) {
+		ArenaResult result = run_arena(width, height, snek_count, food_count, steps, seed, t);
+		print_result(t, result);
+		printf("  speedup over 1 thread: %.2fx\n", single.seconds / (result.seconds > 0 ? result.seconds : 1e-9));
+		same &= result.checksum == single.checksum;
+	}
+
+	if (!same) {
+		std::cerr << "the checksums differ, the arena isn't deterministic across thread counts" << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,358 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "snek.h"
+#include "board_layout.h"
+#include "occupancy.h"
+#include "rng.h"
+#include "thread_pool.h"
+
+// lots of ai sneks sharing one big board, no SDL in here either.
+// every step happens in two passes: first each snek decides where to go, in parallel, only reading the board and
+// writing to itself (its own random generator included), then one pass in snek order applies all the moves.
+// nothing a thread does depends on which other sneks it got, so the result is the same for any number of threads.
+//
+// rules: every snek moves one cell per step and the board wraps around like in the normal game. moving into a cell
+// that was taken at the start of the step kills the snek (tails don't get out of the way first). when several heads
+// go for the same cell the longest snek gets it and the others die, if the longest ones are the same length they all die.
+// dead sneks leave the board and come back as a new snek of length 1 on a random free cell
+
+struct ArenaSnek {
+	SnekBody body;
+	NodeDirection direction = NodeDirection::UP;
+	NodeDirection planned = NodeDirection::UP; // set by the decide pass
+	Pcg32 rng; // only this snek's decisions use it
+	Cell target_food = 0; // the food it's going for, picks another one once that's gone
+	uint32_t score = 0; // food eaten in this life
+	uint32_t deaths = 0;
+};
+
+class ArenaEngine {
+	private:
+		static constexpr uint32_t no_claim = 0xFFFFFFFF;
+
+		// which heads want a cell this step, found through claims[cell]
+		struct Claim {
+			Cell cell;
+			uint32_t winner;
+			bool tied;
+		};
+
+		std::vector<uint32_t> claims; // per cell, index into claim_list or no_claim. only the claimed ones are reset
+		std::vector<Claim> claim_list;
+		std::vector<Cell> targets; // per snek, where it moves this step
+		std::vector<uint8_t> dies; // per snek
+		std::vector<uint32_t> eaten_slots; // food slots to fill again at the end of the step, and ones that found no room yet
+
+		std::vector<uint32_t> food_slot; // per cell, which foods[] entry is on it
+
+	public:
+		static const size_t max_snek_length = 256; // sneks stop growing here so their buffers stay small
+		static const int lookahead = 24; // free cells a move has to lead to before the ai thinks it's safe
+		static const size_t decide_grain = 64; // sneks per chunk in the parallel pass
+
+		int board_width = 0;
+		int board_height = 0;
+		DynamicBoardLayout layout; // the cells and which one is next to which, the same as the engine's
+		std::vector<ArenaSnek> sneks;
+		OccupancyGrid occupancy; // every snek body
+		OccupancyGrid food_grid; // every food
+		std::vector<Cell> foods;
+		Pcg32 rng; // spawns, only used in the serial pass
+
+		uint64_t step_count = 0;
+		uint64_t snek_steps = 0; // moves decided and applied, the arena's unit of work
+		uint64_t deaths = 0;
+		uint64_t foods_eaten = 0;
+
+		ArenaEngine() {};
+
+		// needs room for every snek and food, allocates everything the steps will use
+		void reset(int width, int height, size_t snek_count, size_t food_count, uint64_t seed) {
+			board_width = width;
+			board_height = height;
+			layout.resize(width, height);
+			rng.seed(seed);
+
+			size_t cells = (size_t)width * height;
+			occupancy.reset(cells);
+			food_grid.reset(cells);
+			claims.assign(cells, no_claim);
+			food_slot.assign(cells, 0);
+			claim_list.clear();
+			claim_list.reserve(snek_count);
+			targets.assign(snek_count, 0);
+			dies.assign(snek_count, 0);
+			eaten_slots.clear();
+			eaten_slots.reserve(food_count);
+
+			sneks.resize(snek_count);
+			for (size_t i = 0; i < snek_count; i++) {
+				sneks[i].rng.seed(seed, i + 1); // a stream per snek
+				sneks[i].deaths = 0;
+				spawn_snek(sneks[i]);
+			}
+
+			foods.assign(food_count, 0);
+			for (uint32_t slot = 0; slot < food_count; slot++)
+				spawn_food(slot);
+
+			step_count = 0;
+			snek_steps = 0;
+			deaths = 0;
+			foods_eaten = 0;
+		}
+
+		// one step for every snek, the decisions are spread over the pool
+		void step(ThreadPool& pool) {
+			pool.parallel_for(0, sneks.size(), decide_grain, [this](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++)
+					decide(sneks[i]);
+			});
+			resolve();
+		}
+
+		// the ai: head for the target food on free cells, but not into a pocket smaller than the lookahead.
+		// reads the board, writes only to the snek itself
+		void decide(ArenaSnek& snek) const {
+			if (foods.empty())
+				snek.planned = snek.direction;
+			else {
+				if (!food_grid.test(snek.target_food))
+					snek.target_food = foods[snek.rng.bounded((uint32_t)foods.size())];
+
+				const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+				int target_x = cell_x(snek.target_food), target_y = cell_y(snek.target_food);
+				Cell head = snek.body.head();
+
+				NodeDirection best = snek.direction;
+				int best_score = -(1 << 30);
+
+				for (NodeDirection dir : directions) {
+					if (snek.body.size() > 1 && dir == opposite(snek.direction))
+						continue;
+
+					Cell next = neighbour_cell(head, dir);
+					if (occupancy.test(next))
+						continue;
+
+					int score = -(wrapped_distance(cell_x(next), target_x, board_width) + wrapped_distance(cell_y(next), target_y, board_height));
+					if (!has_room(next))
+						score -= 1 << 20;
+
+					if (score > best_score || (score == best_score && dir == snek.direction)) {
+						best_score = score;
+						best = dir;
+					}
+				}
+				snek.planned = best; // straight on into whatever is there if nothing was free
+			}
+		}
+
+		// whether a flood fill from cell reaches lookahead free cells, with no allocation
+		bool has_room(Cell cell) const {
+			const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+			Cell seen[lookahead];
+			int seen_count = 1, next_to_visit = 0;
+			seen[0] = cell;
+
+			while (next_to_visit < seen_count) {
+				Cell from = seen[next_to_visit++];
+
+				for (NodeDirection dir : directions) {
+					Cell neighbour = neighbour_cell(from, dir);
+					if (occupancy.test(neighbour))
+						continue;
+
+					bool already_seen = false;
+					for (int i = 0; i < seen_count && !already_seen; i++)
+						already_seen = seen[i] == neighbour;
+					if (already_seen)
+						continue;
+
+					if (seen_count + 1 == lookahead)
+						return true;
+					seen[seen_count++] = neighbour;
+				}
+			}
+			return false;
+		}
+
+		// applies every planned move in snek order
+		void resolve() {
+			// who goes where, and who wins each contested cell
+			for (size_t i = 0; i < sneks.size(); i++) {
+				ArenaSnek& snek = sneks[i];
+				snek.direction = snek.planned;
+				Cell target = neighbour_cell(snek.body.head(), snek.direction);
+				targets[i] = target;
+
+				if (claims[target] == no_claim) {
+					claims[target] = (uint32_t)claim_list.size();
+					claim_list.push_back({ target, (uint32_t)i, false });
+				}
+				else {
+					Claim& claim = claim_list[claims[target]];
+					size_t length = snek.body.size(), winner_length = sneks[claim.winner].body.size();
+
+					if (length > winner_length) {
+						claim.winner = (uint32_t)i;
+						claim.tied = false;
+					}
+					else if (length == winner_length)
+						claim.tied = true;
+				}
+			}
+
+			for (size_t i = 0; i < sneks.size(); i++) {
+				const Claim& claim = claim_list[claims[targets[i]]];
+				dies[i] = occupancy.test(targets[i]) || claim.winner != i || claim.tied;
+			}
+
+			// the dead leave first, nobody moves into their cells this step anyway since those were taken
+			for (size_t i = 0; i < sneks.size(); i++) {
+				if (dies[i])
+					remove_snek(sneks[i]);
+			}
+
+			for (size_t i = 0; i < sneks.size(); i++) {
+				if (!dies[i])
+					move_snek(sneks[i], targets[i]);
+			}
+
+			for (size_t i = 0; i < sneks.size(); i++) {
+				if (dies[i]) {
+					sneks[i].deaths++;
+					deaths++;
+					spawn_snek(sneks[i]);
+				}
+			}
+
+			size_t unfilled = 0;
+			for (uint32_t slot : eaten_slots) {
+				if (!spawn_food(slot))
+					eaten_slots[unfilled++] = slot; // the board is full, again next step
+			}
+			eaten_slots.resize(unfilled);
+
+			for (const Claim& claim : claim_list)
+				claims[claim.cell] = no_claim;
+			claim_list.clear();
+
+			step_count++;
+			snek_steps += sneks.size();
+		}
+
+		void move_snek(ArenaSnek& snek, Cell target) {
+			bool ate = food_grid.test(target);
+			if (ate) {
+				food_grid.clear(target);
+				eaten_slots.push_back(food_slot[target]);
+				snek.score++;
+				foods_eaten++;
+			}
+
+			if (!ate || snek.body.full()) {
+				Cell old_tail = snek.body.tail();
+				snek.body.pop_tail();
+				if (snek.body.size() == 0 || snek.body.tail() != old_tail)
+					occupancy.clear(old_tail);
+			}
+
+			snek.body.push_head(target);
+			occupancy.set(target);
+		}
+
+		void remove_snek(ArenaSnek& snek) {
+			for (size_t i = 0; i < snek.body.size(); i++)
+				occupancy.clear(snek.body.at(i));
+		}
+
+		// a new snek of length 1 on a random cell without a snek or food. there's always one: reset() only takes as many
+		// sneks as fit and one that died left its cells free, and no food lands on them before this
+		void spawn_snek(ArenaSnek& snek) {
+			Cell cell = 0;
+			random_free_cell(cell);
+			snek.body.reset(max_snek_length, cell);
+			occupancy.set(cell);
+
+			const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+			snek.direction = directions[rng.bounded(4)];
+			snek.planned = snek.direction;
+			snek.target_food = cell;
+			snek.score = 0;
+		}
+
+		// false if there's no room for it, the slot stays empty then like BasicSnekEngine leaves the food out on a full board
+		bool spawn_food(uint32_t slot) {
+			Cell cell = 0;
+			if (!random_free_cell(cell))
+				return false;
+			foods[slot] = cell;
+			food_slot[cell] = slot;
+			food_grid.set(cell);
+			return true;
+		}
+
+		// a cell with no snek and no food, false if there's none. a few random tries first since food is sparse compared
+		// to the free cells, then the first such cell in board order
+		bool random_free_cell(Cell& cell) {
+			if (occupancy.free_count() == 0)
+				return false;
+			for (int attempt = 0; attempt < 16; attempt++) {
+				cell = occupancy.nth_free(rng.bounded((uint32_t)occupancy.free_count()));
+				if (!food_grid.test(cell))
+					return true;
+			}
+
+			Cell cells = (Cell)((size_t)board_width * board_height);
+			for (cell = 0; cell < cells; cell++) {
+				if (!occupancy.test(cell) && !food_grid.test(cell))
+					return true;
+			}
+			return false;
+		}
+
+		// a hash of every snek and food, equal hashes after the same steps mean the runs played out the same
+		uint64_t checksum() const {
+			uint64_t hash = 0xcbf29ce484222325ULL; // fnv-1a
+			auto mix = [&hash](uint64_t value) {
+				hash = (hash ^ value) * 0x100000001b3ULL;
+			};
+
+			for (const ArenaSnek& snek : sneks) {
+				mix((uint64_t)snek.direction);
+				mix(snek.score);
+				mix(snek.deaths);
+				for (size_t i = 0; i < snek.body.size(); i++)
+					mix(snek.body.at(i));
+			}
+			for (Cell food : foods)
+				mix(food);
+			return hash;
+		}
+
+		Cell make_cell(int x, int y) const {
+			return layout.make_cell(x, y);
+		}
+
+		int cell_x(Cell cell) const {
+			return layout.cell_x(cell);
+		}
+
+		int cell_y(Cell cell) const {
+			return layout.cell_y(cell);
+		}
+
+		// the cell next to the given one, wrapping around the board edges
+		Cell neighbour_cell(Cell cell, NodeDirection dir) const {
+			return layout.neighbour_cell(cell, dir);
+		}
+
+		static int wrapped_distance(int a, int b, int size) {
+			int d = abs(a - b);
+			return d < size - d ? d : size - d;
+		}
+};
\ No newline at end of file
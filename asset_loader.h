@@ -0,0 +1,204 @@
+#pragma once
+#include <iostream>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_mixer.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "thread_pool.h"
+#include "asset_pack.h"
+#include "profiler.h"
+
+// loads images and sounds in the background: png decoding and wav loading run on a thread pool while the main thread
+// keeps handling events and drawing, then the main thread takes the results and does the gpu uploads itself since the
+// renderer only works from the thread that made it. assets are asked for in batches and a batch only starts once the one
+// before it is done, so whatever has to be on screen first can be put in the first batch.
+// assets that are in the asset pack come out of its mapping instead: images and sound effects need no decoding at all then
+
+enum class AssetKind {
+	IMAGE, // decoded into an RGBA32 surface
+	SOUND, // decoded into a Mix_Chunk, sound effects are short and get played a lot
+	MUSIC // opened as a Mix_Music, which keeps the file open and decodes a bit of it at a time while it plays
+};
+
+struct Asset {
+	std::string path;
+	AssetKind kind = AssetKind::IMAGE;
+	SDL_Surface* surface = nullptr;
+	Mix_Chunk* chunk = nullptr;
+	Mix_Music* music = nullptr;
+};
+
+class AssetLoader {
+	private:
+		std::vector<Asset> assets;
+		std::vector<size_t> batch_ends; // batch b is assets[batch_ends[b - 1], batch_ends[b])
+		std::thread loader;
+		bool started = false;
+
+		std::mutex mutex;
+		std::condition_variable batch_done;
+		size_t batches_loaded = 0; // guarded by mutex
+		std::atomic<size_t> assets_loaded { 0 };
+
+		void load(Asset& asset) {
+			SNEK_PROFILE_ZONE("AssetLoader::load");
+
+			SDL_RWops* packed = pack != nullptr && asset.kind == AssetKind::MUSIC ? pack->open_file(asset.path) : nullptr;
+
+			if (asset.kind == AssetKind::IMAGE) {
+				asset.surface = pack != nullptr ? pack->image(asset.path) : nullptr; // the pack's pixels, no decoding
+
+				if (asset.surface == nullptr) {
+					SDL_Surface* loaded = IMG_Load(asset.path.c_str());
+					if (loaded == NULL)
+						std::cerr << "failed to load image \"" << asset.path << "\", error: " << IMG_GetError() << std::endl;
+					else {
+						asset.surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+						SDL_FreeSurface(loaded);
+					}
+				}
+			}
+			else if (asset.kind == AssetKind::SOUND) {
+				// the pack's samples are played straight from the mapping, as long as the device took the format they're in
+				const PackEntry* sound = pack != nullptr ? pack->sound(asset.path) : nullptr;
+				int frequency = 0, channels = 0;
+				Uint16 format = 0;
+				if (sound != nullptr && Mix_QuerySpec(&frequency, &format, &channels) != 0 && frequency == (int)sound->width
+					&& format == AssetPack::sound_format && channels == (int)sound->height)
+					asset.chunk = Mix_QuickLoad_RAW((Uint8*)pack->data(*sound), (Uint32)sound->size);
+				else
+					asset.chunk = Mix_LoadWAV(asset.path.c_str());
+				if (asset.chunk == NULL)
+					std::cerr << "failed to load sound \"" << asset.path << "\", error: " << Mix_GetError() << std::endl;
+			}
+			else {
+				asset.music = packed != nullptr ? Mix_LoadMUS_RW(packed, 1) : Mix_LoadMUS(asset.path.c_str()); // streams from the mapping
+				if (asset.music == NULL)
+					std::cerr << "failed to open music \"" << asset.path << "\", error: " << Mix_GetError() << std::endl;
+			}
+
+			assets_loaded.fetch_add(1, std::memory_order_release);
+			wake_main_thread();
+		}
+
+		void load_all(unsigned int thread_count) {
+			ThreadPool pool(thread_count);
+			size_t first = 0;
+
+			for (size_t end : batch_ends) {
+				pool.parallel_for(first, end, 1, [this](size_t begin, size_t last) {
+					for (size_t i = begin; i < last; i++)
+						load(assets[i]);
+				});
+				first = end;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					batches_loaded++;
+				}
+				batch_done.notify_all();
+			}
+		}
+
+		// an empty event, so a main thread that's asleep waiting for input gets up and takes what was loaded
+		static void wake_main_thread() {
+			SDL_Event event = {};
+			event.type = SDL_USEREVENT;
+			SDL_PushEvent(&event);
+		}
+
+	public:
+		const AssetPack* pack = nullptr; // has to stay open as long as anything loaded from it is around
+
+		AssetLoader() {};
+
+		~AssetLoader() {
+			if (loader.joinable())
+				loader.join();
+		}
+
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		// returns the asset's index, only before start()
+		size_t add(const char* path, AssetKind kind) {
+			Asset asset;
+			asset.path = path;
+			asset.kind = kind;
+			assets.push_back(asset);
+			return assets.size() - 1;
+		}
+
+		// everything added since the last call makes up a batch, returns its number
+		size_t end_batch() {
+			batch_ends.push_back(assets.size());
+			return batch_ends.size() - 1;
+		}
+
+		// thread_count counts the loader thread too, 0 means one per hardware thread
+		void start(unsigned int thread_count = 0) {
+			if (started)
+				return;
+			if (batch_ends.empty() || batch_ends.back() != assets.size())
+				end_batch();
+
+			started = true;
+			loader = std::thread(&AssetLoader::load_all, this, thread_count);
+		}
+
+		bool batch_loaded(size_t batch) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return batches_loaded > batch;
+		}
+
+		bool all_loaded() {
+			return batch_loaded(batch_ends.size() - 1);
+		}
+
+		void wait_for_batch(size_t batch) {
+			std::unique_lock<std::mutex> lock(mutex);
+			batch_done.wait(lock, [&]() { return batches_loaded > batch; });
+		}
+
+		void wait_for_all() {
+			if (!batch_ends.empty())
+				wait_for_batch(batch_ends.size() - 1);
+		}
+
+		// only once the asset's batch is loaded, whoever takes a surface, chunk or music owns it from then on
+		Asset& get(size_t index) {
+			return assets[index];
+		}
+
+		size_t size() const {
+			return assets.size();
+		}
+
+		size_t loaded_count() const {
+			return assets_loaded.load(std::memory_order_acquire);
+		}
+
+		// waits for the loader and frees whatever nobody took, has to be called before SDL_mixer and SDL are shut down
+		void release_all() {
+			if (loader.joinable())
+				loader.join();
+
+			for (Asset& asset : assets) {
+				if (asset.surface != nullptr)
+					SDL_FreeSurface(asset.surface);
+				if (asset.chunk != nullptr)
+					Mix_FreeChunk(asset.chunk);
+				if (asset.music != nullptr)
+					Mix_FreeMusic(asset.music);
+				asset.surface = nullptr;
+				asset.chunk = nullptr;
+				asset.music = nullptr;
+			}
+		}
+};
\ No newline at end of file
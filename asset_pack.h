@@ -0,0 +1,143 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include "mapped_file.h"
+
+// every asset of the game in one file, made by pack.cpp. the game maps it once and hands SDL pointers straight into the
+// mapping, so starting up is one open and one mmap instead of a file per asset, and images need no png decoding.
+//
+// the file is "SNKP", then little endian u32 version and entry count, then one index entry per asset:
+//   u16 name length, the name (the asset's path, e.g. "sprites/grid.png"), u8 kind, u32 width, u32 height, u64 offset, u64 size
+// and then the data, every entry starting on a 16 byte boundary. images are stored as tightly packed RGBA32 pixels and
+// sound effects as samples already in the format the game opens the mixer with (width is the sample rate and height the
+// channels then), so neither needs decoding or copying. everything else (music, ttf) is the file's bytes, sdl decodes
+// those from memory just as well as from disk
+
+struct PackEntry {
+	uint8_t kind = 0;
+	uint32_t width = 0; // images only
+	uint32_t height = 0;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+class AssetPack {
+	private:
+		MappedFile file;
+		std::unordered_map<std::string, PackEntry> entries;
+
+		template <class T>
+		static bool read(const uint8_t* data, size_t size, size_t& offset, T& value) {
+			if (size - offset < sizeof(T))
+				return false;
+			memcpy(&value, data + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+
+	public:
+		static const uint32_t version = 2;
+		static const uint8_t entry_file = 0;
+		static const uint8_t entry_image = 1; // RGBA32, width * 4 bytes per row
+		static const uint8_t entry_sound = 2; // sound_format samples, height interleaved channels
+		static const size_t alignment = 16;
+
+		// what the game opens the mixer with and the pack's sounds are stored as
+		static const int sound_frequency = 44100;
+		static const SDL_AudioFormat sound_format = AUDIO_S16SYS;
+		static const int sound_channels = 2;
+
+		AssetPack() {};
+
+		AssetPack(const AssetPack&) = delete;
+		AssetPack& operator=(const AssetPack&) = delete;
+
+		// false if there's no pack or it's broken, the caller falls back to the loose files then
+		bool open(const char* path) {
+			entries.clear();
+			if (!file.open(path))
+				return false;
+
+			const uint8_t* data = file.data();
+			size_t size = file.size();
+			size_t offset = 4;
+			uint32_t file_version = 0, count = 0;
+
+			if (size < 12 || memcmp(data, "SNKP", 4) != 0 || !read(data, size, offset, file_version) || file_version != version || !read(data, size, offset, count)) {
+				close();
+				return false;
+			}
+
+			for (uint32_t i = 0; i < count; i++) {
+				uint16_t name_length = 0;
+				PackEntry entry;
+				if (!read(data, size, offset, name_length) || size - offset < name_length) {
+					close();
+					return false;
+				}
+				std::string name((const char*)data + offset, name_length);
+				offset += name_length;
+
+				if (!read(data, size, offset, entry.kind) || !read(data, size, offset, entry.width) || !read(data, size, offset, entry.height)
+					|| !read(data, size, offset, entry.offset) || !read(data, size, offset, entry.size) || entry.offset > size || entry.size > size - entry.offset
+					|| (entry.kind == entry_image && entry.size != (uint64_t)entry.width * entry.height * 4)
+					|| (entry.kind == entry_sound && (entry.height == 0 || entry.size % (entry.height * 2) != 0))) {
+					close();
+					return false;
+				}
+				entries[name] = entry;
+			}
+			return true;
+		}
+
+		void close() {
+			entries.clear();
+			file.close();
+		}
+
+		bool is_open() const {
+			return file.is_open();
+		}
+
+		size_t entry_count() const {
+			return entries.size();
+		}
+
+		size_t size() const {
+			return file.size();
+		}
+
+		const PackEntry* find(const std::string& name) const {
+			auto found = entries.find(name);
+			return found != entries.end() ? &found->second : nullptr;
+		}
+
+		const uint8_t* data(const PackEntry& entry) const {
+			return file.data() + entry.offset;
+		}
+
+		// reads the file straight out of the mapping, nullptr if it isn't in the pack. the pack has to stay open while it's used
+		SDL_RWops* open_file(const std::string& name) const {
+			const PackEntry* entry = find(name);
+			if (entry == nullptr || entry->kind != entry_file)
+				return nullptr;
+			return SDL_RWFromConstMem(data(*entry), (int)entry->size);
+		}
+
+		// a surface whose pixels are the ones in the mapping, nothing is copied. only to read from, nullptr if it isn't in the pack
+		SDL_Surface* image(const std::string& name) const {
+			const PackEntry* entry = find(name);
+			if (entry == nullptr || entry->kind != entry_image)
+				return nullptr;
+			return SDL_CreateRGBSurfaceWithFormatFrom((void*)data(*entry), (int)entry->width, (int)entry->height, 32, (int)entry->width * 4, SDL_PIXELFORMAT_RGBA32);
+		}
+
+		// the samples of a sound effect in the mapping, nullptr if it isn't in the pack
+		const PackEntry* sound(const std::string& name) const {
+			const PackEntry* entry = find(name);
+			return entry != nullptr && entry->kind == entry_sound ? entry : nullptr;
+		}
+};
\ No newline at end of file
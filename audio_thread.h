@@ -0,0 +1,113 @@
+#pragma once
+#include <SDL_mixer.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "spsc_queue.h"
+
+// plays sounds and music for the simulation thread, so a slow SDL_mixer call (it locks the audio device, and starting
+// music can touch the file) never holds up a tick. the simulation pushes commands into a queue and carries on, this
+// thread does the SDL_mixer calls in the order they came in. when the queue is full the command is dropped, a missing
+// sound effect is better than a late tick
+
+enum class AudioCommandType {
+	PLAY_SOUND,
+	PLAY_MUSIC,
+	HALT_MUSIC
+};
+
+struct AudioCommand {
+	AudioCommandType type = AudioCommandType::PLAY_SOUND;
+	Mix_Chunk* chunk = nullptr;
+	Mix_Music* music = nullptr;
+	int loops = 0;
+};
+
+class AudioThread {
+	private:
+		SpscQueue<AudioCommand, 64> queue;
+		std::thread thread;
+		bool started = false;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false; // guarded by mutex
+
+		static void execute(const AudioCommand& command) {
+			switch (command.type) {
+				case AudioCommandType::PLAY_SOUND:
+					Mix_PlayChannel(-1, command.chunk, command.loops);
+					break;
+				case AudioCommandType::PLAY_MUSIC:
+					Mix_PlayMusic(command.music, command.loops); // stops whatever was playing
+					break;
+				case AudioCommandType::HALT_MUSIC:
+					Mix_HaltMusic();
+					break;
+			}
+		}
+
+		void thread_main() {
+			AudioCommand command;
+
+			for (;;) {
+				while (queue.pop(command))
+					execute(command);
+
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || !queue.empty(); });
+				if (stopping && queue.empty())
+					return; // everything that was asked for got played
+			}
+		}
+
+	public:
+		unsigned long long dropped = 0; // commands that didn't fit in the queue, only the submitting thread touches it
+
+		AudioThread() {};
+
+		~AudioThread() {
+			stop();
+		}
+
+		AudioThread(const AudioThread&) = delete;
+		AudioThread& operator=(const AudioThread&) = delete;
+
+		void start() {
+			if (started)
+				return;
+			stopping = false;
+			started = true;
+			thread = std::thread(&AudioThread::thread_main, this);
+		}
+
+		// plays what's still queued and waits for the thread to finish
+		void stop() {
+			if (!started)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_one();
+			thread.join();
+			started = false;
+		}
+
+		bool running() const {
+			return started;
+		}
+
+		// from one thread only. the lock is just so the wakeup can't slip in between the audio thread finding the queue
+		// empty and going to sleep, it's never held while SDL_mixer is being called
+		void submit(const AudioCommand& command) {
+			if (!queue.push(command)) {
+				dropped++;
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			wake.notify_one();
+		}
+};
\ No newline at end of file
@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "engine.h"
+#include "hamiltonian.h"
+
+// plays the game on its own: follows a breadth first search from the food, takes that shortcut only when it can't
+// trap itself and otherwise goes round a hamiltonian cycle (or chases its own tail on boards that don't have one).
+// every buffer is sized once per board size, so deciding never allocates. each decision stops searching when its
+// time budget is up and the search picks up where it stopped on the next move, the food doesn't go anywhere until eaten.
+// no SDL in here, the game turns its answers into key presses and the headless runner uses it as a workload
+
+// a breadth first search outwards from one cell over the free cells, that can be stopped and carried on later
+class DistanceField {
+	private:
+		std::vector<uint32_t> stamps; // == generation when the cell was reached by the current search
+		std::vector<uint32_t> distances;
+		std::vector<Cell> queue; // every cell goes in at most once per search, so it never wraps
+		size_t queue_front = 0;
+		size_t queue_back = 0;
+		uint32_t generation = 0;
+
+	public:
+		Cell source = 0;
+		bool started = false;
+
+		DistanceField() {};
+
+		void resize(size_t cells) {
+			stamps.assign(cells, 0);
+			distances.assign(cells, 0);
+			queue.assign(cells, 0);
+			generation = 0;
+			started = false;
+		}
+
+		// forgets the last search in O(1), only every 4 billion searches the stamps have to be cleared
+		void start(Cell from) {
+			if (++generation == 0) {
+				std::fill(stamps.begin(), stamps.end(), 0);
+				generation = 1;
+			}
+			source = from;
+			started = true;
+			stamps[from] = generation;
+			distances[from] = 0;
+			queue[0] = from;
+			queue_front = 0;
+			queue_back = 1;
+		}
+
+		bool reached(Cell cell) const {
+			return started && stamps[cell] == generation;
+		}
+
+		uint32_t distance(Cell cell) const {
+			return distances[cell];
+		}
+
+		bool exhausted() const {
+			return queue_front == queue_back;
+		}
+
+		// expands cells until the first (or every) goal has a distance, nothing is left to expand or the deadline passes.
+		// returns false only when it stopped because of the deadline
+		template <class Clock>
+		bool grow(const SnekEngine& engine, const Cell* goals, int goal_count, bool every_goal, typename Clock::time_point deadline, uint64_t& expanded) {
+			const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+
+			int goals_reached = 0;
+			for (int i = 0; i < goal_count; i++)
+				goals_reached += reached(goals[i]);
+			if (goals_reached > 0 && (!every_goal || goals_reached == goal_count))
+				return true;
+
+			size_t since_clock_check = 0;
+			while (queue_front != queue_back) {
+				if (++since_clock_check == 64) {
+					since_clock_check = 0;
+					if (Clock::now() >= deadline)
+						return false;
+				}
+
+				Cell from = queue[queue_front++];
+				expanded++;
+
+				for (NodeDirection dir : directions) {
+					Cell next = engine.neighbour_cell(from, dir);
+					if (stamps[next] == generation || engine.occupancy.test(next))
+						continue;
+
+					stamps[next] = generation;
+					distances[next] = distances[from] + 1;
+					queue[queue_back++] = next;
+
+					for (int i = 0; i < goal_count; i++) {
+						if (next == goals[i] && (!every_goal || ++goals_reached == goal_count))
+							return true;
+					}
+				}
+			}
+			return true;
+		}
+};
+
+class Autopilot {
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		int width = 0;
+		int height = 0;
+		std::vector<NodeDirection> cycle; // empty if the board has no hamiltonian cycle
+		std::vector<uint32_t> cycle_position; // where every cell is along the cycle
+
+		DistanceField food_field; // from the food, carried over to the next move when it ran out of time
+		DistanceField tail_field; // from the tail, redone whenever it's needed since the tail moves every time
+		uint64_t last_tail_search = ~0ULL; // tick the tail field was started on
+		uint64_t last_tick_count = 0;
+		uint64_t last_foods_eaten = 0;
+		uint64_t moves_since_food = 0;
+
+		// how far ahead of the head a cell is when going round the cycle
+		uint32_t cycle_distance(Cell from, Cell to) const {
+			uint32_t cells = (uint32_t)cycle_position.size();
+			return (cycle_position[to] + cells - cycle_position[from]) % cells;
+		}
+
+		// whether the snek can move into cell without dying (the tail gets out of the way unless it's doubled up)
+		static bool enterable(const SnekEngine& engine, Cell cell) {
+			if (!engine.occupancy.test(cell))
+				return true;
+			return engine.snek.size() > 1 && cell == engine.snek.tail() && engine.snek.at(engine.snek.size() - 2) != cell;
+		}
+
+		// going round the cycle can never trap the snek as long as its body lies in cycle order from the tail to the head.
+		// jumping ahead keeps that order if it doesn't land past the tail (with a little room for growing).
+		// a segment that just grew sits wherever there was room behind the tail, so the one before it counts as the tail too
+		bool safe_on_cycle(const SnekEngine& engine, uint32_t to_cell) const {
+			if (to_cell == 1 || engine.snek.size() == 1)
+				return true;
+
+			Cell head = engine.snek.head();
+			uint32_t to_tail = cycle_distance(head, engine.snek.tail());
+			if (engine.snek.size() > 2) {
+				uint32_t to_before_tail = cycle_distance(head, engine.snek.at(engine.snek.size() - 2));
+				if (to_before_tail < to_tail)
+					to_tail = to_before_tail;
+			}
+			return to_cell + growth_room < to_tail;
+		}
+
+		// boards without a cycle: a move is fine if the tail can still be reached from where it ends up
+		bool tail_reachable(const SnekEngine& engine, Cell cell, Clock::time_point deadline) {
+			if (cell == engine.snek.tail())
+				return true;
+			search_tail(engine, &cell, 1, false, deadline);
+			return tail_field.reached(cell);
+		}
+
+		static bool reaches_any(const DistanceField& field, const Cell* cells, int count) {
+			for (int i = 0; i < count; i++) {
+				if (field.reached(cells[i]))
+					return true;
+			}
+			return false;
+		}
+
+		// the tail moves every time, so its field starts over once per move and is only grown as far as needed
+		void search_tail(const SnekEngine& engine, const Cell* goals, int goal_count, bool every_goal, Clock::time_point deadline) {
+			if (last_tail_search != engine.tick_count) {
+				tail_field.start(engine.snek.tail());
+				last_tail_search = engine.tick_count;
+			}
+			if (!tail_field.grow<Clock>(engine, goals, goal_count, every_goal, deadline, cells_expanded))
+				budget_overruns++;
+		}
+
+	public:
+		static const uint32_t growth_room = 3; // cells kept between the head and the tail when cutting across the cycle
+
+		uint32_t budget_us = 200; // search time per decision, 0 for no limit
+		uint64_t decisions = 0;
+		uint64_t cells_expanded = 0;
+		uint64_t budget_overruns = 0; // decisions that ran out of time and left the rest of the search for later
+		uint64_t shortcuts = 0; // decisions that went for the food instead of following the cycle or the tail
+
+		Autopilot() {};
+
+		// sizes everything for the engine's board, decide() calls it by itself when the board size changes
+		void reset(const SnekEngine& engine) {
+			width = engine.board_width;
+			height = engine.board_height;
+			size_t cells = (size_t)width * height;
+
+			if (build_hamiltonian_cycle(width, height, cycle)) {
+				cycle_position.assign(cells, 0);
+				Cell cell = 0;
+				for (uint32_t i = 0; i < cells; i++) {
+					cycle_position[cell] = i;
+					cell = engine.neighbour_cell(cell, cycle[cell]);
+				}
+			}
+			else {
+				cycle.clear();
+				cycle_position.clear();
+			}
+
+			food_field.resize(cells);
+			tail_field.resize(cells);
+			last_tail_search = ~0ULL;
+		}
+
+		bool has_cycle() const {
+			return !cycle.empty();
+		}
+
+		// the direction to go next, never the way back into the neck
+		NodeDirection decide(const SnekEngine& engine) {
+			Clock::time_point deadline = budget_us > 0 ? Clock::now() + std::chrono::microseconds(budget_us) : Clock::time_point::max();
+
+			if (engine.board_width != width || engine.board_height != height)
+				reset(engine);
+			if (engine.tick_count < last_tick_count)
+				food_field.started = false; // a new game, whatever was searched belongs to the old board
+			last_tick_count = engine.tick_count;
+			decisions++;
+
+			if (engine.foods_eaten != last_foods_eaten) {
+				last_foods_eaten = engine.foods_eaten;
+				moves_since_food = 0;
+			}
+			moves_since_food++;
+
+			// the cells the snek can step on next, never back into its neck
+			const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+			Cell options[4];
+			NodeDirection option_directions[4];
+			int option_count = 0;
+			for (NodeDirection dir : directions) {
+				Cell next = engine.neighbour_cell(engine.snek.head(), dir);
+				if ((dir == engine.current_direction || engine.can_turn(dir)) && enterable(engine, next)) {
+					options[option_count] = next;
+					option_directions[option_count++] = dir;
+				}
+			}
+			if (option_count == 0)
+				return engine.current_direction; // boxed in
+
+			// the food search is kept from move to move: one that ran out of time carries on where it stopped, and its
+			// distances stay usable since walking down them never crosses the cells the snek has been on since. it doesn't
+			// know about cells that were freed in the meantime though, so when it can't reach the snek any more it starts over
+			bool fresh = !food_field.started || food_field.source != engine.food_cell;
+			if (fresh)
+				food_field.start(engine.food_cell);
+			bool pending = !food_field.grow<Clock>(engine, options, option_count, false, deadline, cells_expanded);
+
+			if (!fresh && !pending && !reaches_any(food_field, options, option_count)) {
+				food_field.start(engine.food_cell);
+				pending = !food_field.grow<Clock>(engine, options, option_count, false, deadline, cells_expanded);
+			}
+			if (pending)
+				budget_overruns++;
+
+			// the searched way to the food, if it's safe
+			Cell head = engine.snek.head();
+			int best = -1;
+			for (int i = 0; i < option_count; i++) {
+				if (food_field.reached(options[i]) && (best < 0 || food_field.distance(options[i]) < food_field.distance(options[best])))
+					best = i;
+			}
+
+			if (!cycle.empty()) {
+				// the searched way is taken as long as it doesn't break the cycle order. that alone can go round in circles,
+				// so once the snek took a lot longer than walking straight there would only cuts that don't jump past the food
+				// are allowed: each of those gets closer to it along the cycle, so it's reached within a lap at the latest
+				uint32_t to_food = cycle_distance(head, engine.food_cell);
+				bool strict = moves_since_food >= (uint64_t)(width + height) * 4;
+
+				if (!strict && best >= 0 && safe_on_cycle(engine, cycle_distance(head, options[best]))) {
+					shortcuts += option_directions[best] != cycle[head];
+					return option_directions[best];
+				}
+
+				best = -1;
+				uint32_t best_along = 0;
+				for (int i = 0; i < option_count; i++) {
+					uint32_t to_cell = cycle_distance(head, options[i]);
+					if (to_cell == 0 || to_cell > to_food || !safe_on_cycle(engine, to_cell))
+						continue;
+
+					// searched distance first, then whatever gets furthest round the cycle
+					bool better = best < 0;
+					if (!better && food_field.reached(options[i]) != food_field.reached(options[best]))
+						better = food_field.reached(options[i]);
+					else if (!better && food_field.reached(options[i]) && food_field.distance(options[i]) != food_field.distance(options[best]))
+						better = food_field.distance(options[i]) < food_field.distance(options[best]);
+					else if (!better)
+						better = to_cell > best_along;
+
+					if (better) {
+						best = i;
+						best_along = to_cell;
+					}
+				}
+				if (best >= 0) {
+					shortcuts += option_directions[best] != cycle[head];
+					return option_directions[best];
+				}
+
+				for (int i = 0; i < option_count; i++) {
+					if (option_directions[i] == cycle[head])
+						return cycle[head];
+				}
+			}
+			else if (best >= 0 && tail_reachable(engine, options[best], deadline)) {
+				shortcuts++;
+				return option_directions[best];
+			}
+
+			// no cycle or it's blocked: chase the tail the long way round
+			search_tail(engine, options, option_count, true, deadline);
+			best = -1;
+			for (int i = 0; i < option_count; i++) {
+				if (tail_field.reached(options[i]) && (best < 0 || tail_field.distance(options[i]) > tail_field.distance(options[best])))
+					best = i;
+			}
+			return option_directions[best >= 0 ? best : 0];
+		}
+};
\ No newline at end of file
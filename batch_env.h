@@ -0,0 +1,313 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "snek.h"
+#include "board_layout.h"
+#include "occupancy.h"
+#include "rng.h"
+
+// thousands of independent snek games stepped together, for training agents. no SDL in here.
+// one step() moves every snek once: the action is a NodeDirection (0 keeps going) and a sideways one turns the snek
+// first, which is exactly what SnekEngine::turn() does, and a move without a turn is what SnekEngine::tick() does
+// once the move timer runs out. eating, growing, spawning food and wrapping around the edges are the engine's rules
+// and draw the same random numbers, so an environment plays out exactly like a SnekEngine reset with the same seed.
+// the move timer only sets how fast the game runs in real time, so there's nothing of it here.
+//
+// the state is kept as one array per field with an entry per environment, and every step goes over them in passes:
+// first where every head goes next, which is plain arithmetic over the arrays that the compiler vectorises, then one
+// pass that does the collisions, food and the observation for every environment. observations are written straight
+// into a buffer the caller owns, one byte per cell (see the values below) and environments one after the other, and
+// only the cells that changed are touched, the ends of the snek and the food. a game that ended starts over right away
+// in the same step: done is set for it and its observation is already the new game's first one
+
+class BatchEnv {
+	public:
+		// what a cell of the observation holds
+		static const uint8_t cell_empty = 0;
+		static const uint8_t cell_body = 1;
+		static const uint8_t cell_head = 2;
+		static const uint8_t cell_food = 3;
+
+		static const size_t max_cells = 1 << 16; // cells are 16 bit here to keep the arrays small
+
+		size_t env_count = 0;
+		int board_width = 0;
+		int board_height = 0;
+		size_t cells = 0;
+		DynamicBoardLayout layout; // the engine's, for everything but the first pass of step()
+		uint32_t hunger_limit = 0; // moves without eating before a game counts as done, 0 for none
+		uint64_t seed = 0;
+
+		// per environment
+		std::vector<uint8_t> direction; // NodeDirection
+		std::vector<uint16_t> head_x;
+		std::vector<uint16_t> head_y;
+		std::vector<uint32_t> head_slot; // where the head is in the environment's body ring
+		std::vector<uint32_t> length;
+		std::vector<uint16_t> food;
+		std::vector<uint32_t> foods_eaten;
+		std::vector<uint32_t> score; // the game's score, 10 more per food than for the one before
+		std::vector<uint32_t> hunger; // moves since the last food
+		std::vector<uint64_t> episodes; // games started
+		std::vector<uint32_t> final_score; // of the last game that ended
+		std::vector<Pcg32> rngs;
+
+		std::vector<uint16_t> bodies; // cells rings, env_count * cells, index 0 of a ring isn't necessarily the head
+		std::vector<uint64_t> occupancy; // env_count * words bits, padding past the last cell set like OccupancyGrid
+		std::vector<uint32_t> occupied; // set cells per environment
+		size_t words = 0;
+
+		unsigned long long steps_taken = 0; // environment steps, env_count per step()
+
+	private:
+		uint8_t* observations = nullptr;
+
+		// the first pass' results
+		std::vector<uint16_t> next_x;
+		std::vector<uint16_t> next_y;
+
+		bool test(size_t env, uint32_t cell) const {
+			return (occupancy[env * words + (cell >> 6)] >> (cell & 63)) & 1;
+		}
+
+		void set(size_t env, uint32_t cell) {
+			uint64_t& word = occupancy[env * words + (cell >> 6)];
+			uint64_t bit = 1ULL << (cell & 63);
+			occupied[env] += (word & bit) == 0;
+			word |= bit;
+		}
+
+		void clear(size_t env, uint32_t cell) {
+			uint64_t& word = occupancy[env * words + (cell >> 6)];
+			uint64_t bit = 1ULL << (cell & 63);
+			occupied[env] -= (word & bit) != 0;
+			word &= ~bit;
+		}
+
+		// OccupancyGrid::nth_free() over the environment's words
+		uint32_t nth_free(size_t env, size_t k) const {
+			const uint64_t* grid = &occupancy[env * words];
+			for (size_t i = 0; i < words; i++) {
+				uint64_t free_bits = ~grid[i];
+				unsigned int free_here = popcount64(free_bits);
+
+				if (k < free_here)
+					return (uint32_t)(i * 64 + select64(free_bits, (unsigned int)k));
+				k -= free_here;
+			}
+			return 0;
+		}
+
+		uint16_t& body_at(size_t env, size_t i) {
+			size_t slot = head_slot[env] + i;
+			if (slot >= cells)
+				slot -= cells;
+			return bodies[env * cells + slot];
+		}
+
+		uint32_t neighbour_cell(uint32_t cell, int dir) const {
+			return layout.neighbour_cell(cell, (NodeDirection)dir);
+		}
+
+		// SnekEngine::spawn_food(), the food variant is drawn too so the random numbers stay in step with the engine
+		void spawn_food(size_t env) {
+			size_t free_cells = cells - occupied[env];
+			if (free_cells == 0)
+				return;
+
+			food[env] = (uint16_t)nth_free(env, rngs[env].bounded((uint32_t)free_cells));
+			rngs[env].range(0, 3);
+			observations[env * cells + food[env]] = cell_food;
+		}
+
+		// SnekEngine::create_new_snek_node()
+		void grow(size_t env) {
+			if (length[env] == cells)
+				return;
+
+			uint32_t last = body_at(env, length[env] - 1);
+			int grow_direction = (int)NodeDirection::DUMMY_VALUE;
+
+			if (length[env] >= 2) {
+				uint32_t one_before_last = body_at(env, length[env] - 2);
+				for (int dir = (int)NodeDirection::UP; dir <= (int)NodeDirection::RIGHT; dir++) {
+					if (neighbour_cell(one_before_last, dir) == last) {
+						grow_direction = dir;
+						break;
+					}
+				}
+			}
+			else
+				grow_direction = (int)opposite((NodeDirection)direction[env]);
+
+			uint32_t new_tail = neighbour_cell(last, grow_direction);
+			if (test(env, new_tail))
+				new_tail = last;
+
+			length[env]++;
+			body_at(env, length[env] - 1) = (uint16_t)new_tail;
+			set(env, new_tail);
+			if (observations[env * cells + new_tail] == cell_empty)
+				observations[env * cells + new_tail] = cell_body;
+		}
+
+	public:
+		BatchEnv() {};
+
+		// sizes everything, observations needs env_count * width * height bytes and has to outlive the environments.
+		// false if the board is too small or too big
+		bool reset(size_t count, int width, int height, uint64_t seed_value, uint8_t* observation_buffer) {
+			if (width < 2 || height < 2 || (size_t)width * height > max_cells || observation_buffer == nullptr)
+				return false;
+
+			env_count = count;
+			board_width = width;
+			board_height = height;
+			layout.resize(width, height);
+			cells = (size_t)width * height;
+			words = (cells + 63) / 64;
+			seed = seed_value;
+			observations = observation_buffer;
+
+			direction.assign(count, 0);
+			head_x.assign(count, 0);
+			head_y.assign(count, 0);
+			head_slot.assign(count, 0);
+			length.assign(count, 0);
+			food.assign(count, 0);
+			foods_eaten.assign(count, 0);
+			score.assign(count, 0);
+			hunger.assign(count, 0);
+			episodes.assign(count, 0);
+			final_score.assign(count, 0);
+			rngs.assign(count, Pcg32());
+			bodies.assign(count * cells, 0);
+			occupancy.assign(count * words, 0);
+			occupied.assign(count, 0);
+			next_x.assign(count, 0);
+			next_y.assign(count, 0);
+			steps_taken = 0;
+
+			for (size_t env = 0; env < count; env++)
+				start_episode(env);
+			return true;
+		}
+
+		// every game gets its own seed, so any one of them can be played again on a SnekEngine
+		uint64_t episode_seed(size_t env, uint64_t episode) const {
+			uint64_t z = seed + (env << 32) + episode + 0x9e3779b97f4a7c15ULL; // splitmix64
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+
+		// SnekEngine::reset() for one environment, and a fresh observation for it
+		void start_episode(size_t env) {
+			rngs[env].seed(episode_seed(env, episodes[env]++));
+
+			uint64_t* grid = &occupancy[env * words];
+			memset(grid, 0, words * sizeof(uint64_t));
+			if (cells % 64 != 0)
+				grid[words - 1] = ~0ULL << (cells % 64);
+			occupied[env] = 0;
+			memset(observations + env * cells, cell_empty, cells);
+
+			head_x[env] = (uint16_t)(board_width * 2 / 5);
+			head_y[env] = (uint16_t)(board_height / 2);
+			uint32_t start = layout.make_cell(head_x[env], head_y[env]);
+			head_slot[env] = 0;
+			length[env] = 1;
+			bodies[env * cells] = (uint16_t)start;
+			set(env, start);
+			observations[env * cells + start] = cell_head;
+
+			direction[env] = (uint8_t)NodeDirection::UP;
+			foods_eaten[env] = 0;
+			score[env] = 0;
+			hunger[env] = 0;
+			spawn_food(env);
+		}
+
+		// moves every snek once. actions, rewards and dones have an entry per environment. the reward is 1 for eating,
+		// -1 for dying (or starving past hunger_limit) and 0 otherwise
+		void step(const uint8_t* actions, float* rewards, uint8_t* dones) {
+			const int width = board_width, height = board_height;
+
+			// where every head goes, no memory but the arrays and no branches the compiler can't turn into selects. this is
+			// DynamicBoardLayout::neighbour_cell() on x and y, written out so the loop vectorises
+			for (size_t env = 0; env < env_count; env++) {
+				int action = actions[env] <= (uint8_t)NodeDirection::RIGHT ? actions[env] : 0;
+				int current = direction[env];
+				bool vertical_now = current <= (int)NodeDirection::DOWN;
+				bool vertical_action = action <= (int)NodeDirection::DOWN;
+				int dir = (action != 0 && vertical_now != vertical_action) ? action : current;
+				direction[env] = (uint8_t)dir;
+
+				int dx = (dir == (int)NodeDirection::RIGHT) - (dir == (int)NodeDirection::LEFT);
+				int dy = (dir == (int)NodeDirection::DOWN) - (dir == (int)NodeDirection::UP);
+				int x = head_x[env] + dx, y = head_y[env] + dy;
+				x = x < 0 ? width - 1 : (x == width ? 0 : x);
+				y = y < 0 ? height - 1 : (y == height ? 0 : y);
+				next_x[env] = (uint16_t)x;
+				next_y[env] = (uint16_t)y;
+			}
+
+			// SnekEngine::move_snek() and check_food_eat() for every environment
+			for (size_t env = 0; env < env_count; env++) {
+				uint8_t* observation = observations + env * cells;
+				uint32_t old_head = body_at(env, 0);
+				uint32_t new_head = (uint32_t)next_y[env] * width + next_x[env];
+				float reward = 0.0f;
+				bool done = false;
+
+				uint32_t old_tail = body_at(env, length[env] - 1);
+				length[env]--;
+				if (length[env] == 0 || body_at(env, length[env] - 1) != old_tail) {
+					clear(env, old_tail);
+					observation[old_tail] = cell_empty;
+				}
+
+				if (test(env, new_head))
+					done = true; // ran into itself
+				else {
+					head_slot[env] = (head_slot[env] == 0 ? (uint32_t)cells : head_slot[env]) - 1;
+					length[env]++;
+					bodies[env * cells + head_slot[env]] = (uint16_t)new_head;
+					set(env, new_head);
+					head_x[env] = next_x[env];
+					head_y[env] = next_y[env];
+
+					if (length[env] > 1)
+						observation[old_head] = cell_body;
+					observation[new_head] = cell_head;
+
+					if (new_head == food[env]) {
+						foods_eaten[env]++;
+						score[env] += foods_eaten[env] * 10;
+						hunger[env] = 0;
+						reward = 1.0f;
+						grow(env);
+						spawn_food(env);
+					}
+					else if (hunger_limit != 0 && ++hunger[env] >= hunger_limit)
+						done = true;
+				}
+
+				if (done) {
+					if (reward == 0.0f)
+						reward = -1.0f;
+					final_score[env] = score[env];
+					start_episode(env);
+				}
+				rewards[env] = reward;
+				dones[env] = done;
+			}
+			steps_taken += env_count;
+		}
+
+		uint8_t* observation(size_t env) const {
+			return observations + env * cells;
+		}
+};
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+#include "arena.h"
+#include "autopilot.h"
+#include "batch_env.h"
+#include "engine.h"
+#include "game.h"
+#include "hamiltonian.h"
+#include "rewind.h"
+#include "sprite.h"
+#include "text.h"
+#include "thread_pool.h"
+
+// times the game's hot paths and prints one json object per line, e.g.
+// {"name":"move_snek","param":"length=300","iterations":1000000,"ns_per_op":3.1,"allocs_per_op":0}
+// run it from the repository root so the sprites and fonts can be found. "--filter move" only runs matching benchmarks,
+// "--no-sdl" skips everything that needs a renderer, "--min-time 200" sets how many ms each benchmark runs for at least
+
+static double min_time = 0.1; // seconds
+static const char* filter = nullptr;
+static volatile uint64_t sink = 0; // keeps the compiler from throwing away results
+
+template <class Operation>
+static void run_benchmark(const char* name, const std::string& param, Operation&& operation) {
+	if (filter != nullptr && strstr(name, filter) == nullptr)
+		return;
+
+	operation(); // warm up
+
+	uint64_t iterations = 1;
+	for (;;) {
+		uint64_t allocations_before = allocation_count();
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint64_t i = 0; i < iterations; i++)
+			operation();
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		uint64_t allocations = allocation_count() - allocations_before;
+
+		if (elapsed >= min_time || iterations >= (1ULL << 32)) {
+			printf("{\"name\":\"%s\",\"param\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.3f,\"allocs_per_op\":%.3f}\n",
+				name, param.c_str(), (unsigned long long)iterations, elapsed * 1e9 / iterations, (double)allocations / iterations);
+			fflush(stdout);
+			return;
+		}
+		iterations *= elapsed < min_time / 10 ? 10 : 2;
+	}
+}
+
+// puts a snek of the given length on the engine's board, laid along the hamiltonian cycle so it can follow it forever
+template <class Engine>
+static void lay_snek(Engine& engine, const std::vector<NodeDirection>& cycle, size_t length) {
+	size_t cells = (size_t)engine.board_width * engine.board_height;
+	Cell cell = 0;
+
+	engine.snek.reset(cells, cell);
+	engine.occupancy.reset(cells);
+	engine.occupancy.set(cell);
+
+	for (size_t i = 1; i < length; i++) {
+		cell = engine.neighbour_cell(cell, cycle[cell]);
+		engine.snek.push_head(cell);
+		engine.occupancy.set(cell);
+	}
+	engine.current_direction = cycle[engine.snek.head()];
+	engine.generation++; // a board nobody could have a copy of yet
+}
+
+// the engine's own hot paths on the 20x15 board, run once on the engine that takes any size and once on the one
+// compiled for 20x15 (layout=fixed), see board_layout.h
+template <class Engine>
+static void layout_benchmarks(const std::string& layout) {
+	const int width = 20, height = 15;
+	const size_t cells = width * height;
+	const size_t lengths[] = { 1, 16, 75, 150, 225, cells };
+
+	std::vector<NodeDirection> cycle;
+	build_hamiltonian_cycle(width, height, cycle);
+
+	Engine engine;
+
+	for (size_t length : lengths) {
+		engine.reset(width, height, 1);
+		lay_snek(engine, cycle, length);
+		engine.food_cell = (Cell)cells; // off the board, so the snek never eats and keeps its length
+
+		run_benchmark("move_snek", "length=" + std::to_string(length) + layout, [&]() {
+			engine.current_direction = cycle[engine.snek.head()];
+			sink += engine.move_snek();
+		});
+	}
+
+	for (size_t length : lengths) {
+		engine.reset(width, height, 1);
+		lay_snek(engine, cycle, length);
+		NodeDirection ahead = engine.current_direction;
+
+		run_benchmark("self_collision", "length=" + std::to_string(length) + layout, [&]() {
+			sink += engine.occupancy.test(engine.neighbour_cell(engine.snek.head(), ahead));
+		});
+
+		if (!layout.empty())
+			continue;
+
+		// what the check used to cost: comparing the head against every segment
+		run_benchmark("self_collision_scan", "length=" + std::to_string(length), [&]() {
+			Cell head = engine.snek.head();
+			bool hit = false;
+			for (size_t i = 1; i < engine.snek.size(); i++)
+				hit |= engine.snek.at(i) == head;
+			sink += hit;
+		});
+	}
+
+	const int fill_percentages[] = { 0, 25, 50, 75, 90, 99 };
+	for (int percent : fill_percentages) {
+		engine.reset(width, height, 1);
+		engine.occupancy.reset(cells);
+
+		// fill a random set of cells, spawn_food() doesn't change the occupancy so every run sees the same board
+		Pcg32 rng(7);
+		size_t target = cells * percent / 100;
+		while (engine.occupancy.size() - engine.occupancy.free_count() < target)
+			engine.occupancy.set(rng.bounded((uint32_t)cells));
+
+		run_benchmark("spawn_food", "fill=" + std::to_string(percent) + "%" + layout, [&]() {
+			engine.spawn_food();
+			sink += engine.food_cell;
+		});
+	}
+
+	engine.reset(width, height, 1);
+	run_benchmark("engine_tick", "board=20x15" + layout, [&]() {
+		if (!engine.alive)
+			engine.reset(width, height, 1);
+		sink += engine.tick();
+	});
+
+	// every neighbour of every cell, the wrap-around at the edges included
+	Cell cell = 0;
+	run_benchmark("neighbour_cell", "board=20x15" + layout, [&]() {
+		Cell sum = 0;
+		for (int dir = (int)NodeDirection::UP; dir <= (int)NodeDirection::RIGHT; dir++)
+			sum += engine.neighbour_cell(cell, (NodeDirection)dir);
+		sink += sum;
+		cell = cell + 1 < cells ? cell + 1 : 0;
+	});
+}
+
+static void engine_benchmarks() {
+	const int width = 20, height = 15;
+	const size_t cells = width * height;
+
+	layout_benchmarks<SnekEngine>("");
+	layout_benchmarks<BasicSnekEngine<FixedBoardLayout<width, height>>>(", layout=fixed");
+
+	// what the autopilot costs per move while it plays whole games, on the normal board and a big one
+	const int autopilot_boards[][2] = { { 20, 15 }, { 200, 200 } };
+	for (auto& board : autopilot_boards) {
+		SnekEngine played;
+		played.reset(board[0], board[1], 1);
+		Autopilot autopilot;
+		autopilot.budget_us = 0;
+
+		run_benchmark("autopilot_decide", "board=" + std::to_string(board[0]) + "x" + std::to_string(board[1]), [&]() {
+			if (!played.alive || played.occupancy.free_count() == 0)
+				played.reset(board[0], board[1], 1);
+
+			NodeDirection dir = autopilot.decide(played);
+			if (dir != played.current_direction)
+				played.turn(dir);
+			else
+				played.move_snek();
+		});
+	}
+
+	// going back to a random tick of a long game the autopilot played, from the rewind buffer
+	SnekEngine recorded;
+	recorded.reset(40, 30, 1);
+	Autopilot rewind_autopilot;
+	rewind_autopilot.budget_us = 0;
+	RewindBuffer rewind;
+	rewind.configure(1024 * 1024);
+	rewind.record_tick(recorded);
+	while (recorded.alive && recorded.tick_count < 60000) {
+		if (recorded.time + SnekEngine::tick_interval - recorded.snek_move_timer >= recorded.snek_move_interval) {
+			NodeDirection dir = rewind_autopilot.decide(recorded);
+			if (recorded.can_turn(dir)) {
+				rewind.record_turn(recorded, dir);
+				recorded.turn(dir);
+			}
+		}
+		recorded.tick();
+		rewind.record_tick(recorded);
+	}
+	SnekEngine seeked;
+	Pcg32 seek_rng(1);
+	uint64_t range = rewind.newest_tick() - rewind.oldest_tick() + 1;
+
+	run_benchmark("rewind_seek", "board=40x30, ticks=" + std::to_string(range) + ", bytes=" + std::to_string(rewind.bytes_used()), [&]() {
+		rewind.seek(seeked, rewind.oldest_tick() + seek_rng.bounded((uint32_t)range));
+		sink += seeked.snek.head();
+	});
+
+	// one arena step for every snek, on one thread and on all of them
+	const unsigned int thread_counts[] = { 1, 0 };
+	for (unsigned int threads : thread_counts) {
+		ThreadPool pool(threads);
+		ArenaEngine arena;
+		arena.reset(1000, 1000, 1000, 500, 1);
+
+		run_benchmark("arena_step", "sneks=1000, threads=" + std::to_string(pool.thread_count()), [&]() {
+			arena.step(pool);
+			sink += arena.deaths;
+		});
+	}
+
+	// one step of every environment, the actions turn now and then like an agent would
+	const size_t env_count = 4096;
+	std::vector<uint8_t> observations(env_count * cells), actions(env_count, 0), dones(env_count);
+	std::vector<float> rewards(env_count);
+	BatchEnv batch;
+	batch.hunger_limit = (uint32_t)cells * 2;
+	batch.reset(env_count, width, height, 1, observations.data());
+	uint64_t batch_steps = 0;
+
+	run_benchmark("batch_env_step", "envs=4096, board=20x15", [&]() {
+		for (size_t env = batch_steps % 7; env < env_count; env += 7)
+			actions[env] = (uint8_t)((batch_steps + env) % 5);
+		batch.step(actions.data(), rewards.data(), dones.data());
+		sink += dones[batch_steps++ % env_count];
+	});
+}
+
+static void sdl_benchmarks() {
+	GameOptions options;
+	options.offscreen = true;
+	options.has_seed = true;
+	options.seed = 1;
+	options.record_path = nullptr;
+
+	Game game(options);
+	game.finish_loading();
+	if (game.game_state != GameState::GAME_MENU) {
+		std::cerr << "couldn't start the game offscreen, skipping the sdl benchmarks" << std::endl;
+		return;
+	}
+	SDL_Renderer* renderer = game.game_renderer;
+
+	// the way Text used to work: open the font, rasterise the string, upload it, close the font
+	run_benchmark("text_construct_legacy", "\"Score: 12345\"", [&]() {
+		TTF_Font* font = TTF_OpenFont("fonts/dogicapixelbold.ttf", 24);
+		SDL_Surface* surface = TTF_RenderText_Solid(font, "Score: 12345", SDL_Colour { 0, 0, 0, 255 });
+		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+		SDL_DestroyTexture(texture);
+		SDL_FreeSurface(surface);
+		TTF_CloseFont(font);
+	});
+
+	run_benchmark("text_construct_cold", "\"Score: 12345\"", [&]() {
+		TextureCache textures;
+		FontCache fonts(textures);
+		Text text("Score: 12345", renderer, fonts, 10, 10);
+		sink += text.rect.w;
+		fonts.release_all();
+	});
+
+	run_benchmark("text_construct_cached", "\"Score: 12345\"", [&]() {
+		Text text("Score: 12345", renderer, game.fonts, 10, 10);
+		sink += text.rect.w;
+	});
+
+	Text score_text("Score: 0", renderer, game.fonts, 10, 10);
+	char buffer[32];
+	unsigned int score = 0;
+	run_benchmark("text_set_score", "cached atlas", [&]() {
+		snprintf(buffer, sizeof(buffer), "Score: %u", score += 10);
+		score_text.set_text(buffer);
+	});
+
+	run_benchmark("sprite_load_cold", "sprites/snek_tail.png", [&]() {
+		TextureCache textures;
+		Sprite sprite("sprites/snek_tail.png", renderer, textures, 0, 0);
+		sink += sprite.rect.w;
+	});
+
+	Sprite kept_alive("sprites/snek_tail.png", renderer, game.textures, 0, 0);
+	run_benchmark("sprite_load_cached", "sprites/snek_tail.png", [&]() {
+		Sprite sprite("sprites/snek_tail.png", renderer, game.textures, 0, 0);
+		sink += sprite.rect.w;
+	});
+
+	// the same window on a bigger and bigger board, the frame should cost about the same every time
+	const int board_sides[][2] = { { 20, 15 }, { 200, 150 }, { 2000, 1500 } };
+	for (auto& side : board_sides) {
+		game.board_width = side[0];
+		game.board_height = side[1];
+
+		std::vector<NodeDirection> cycle;
+		build_hamiltonian_cycle(game.board_width, game.board_height, cycle);
+		game.initialize_game();
+		game.game_state = GameState::GAME_ACTIVE;
+
+		size_t cells = (size_t)game.board_width * game.board_height;
+		const size_t lengths[] = { 1, 150, cells < 100000 ? cells : 100000 };
+		for (size_t length : lengths) {
+			lay_snek(game.engine, cycle, length);
+
+			run_benchmark("frame_update_render", "software renderer, board=" + std::to_string(side[0]) + "x" + std::to_string(side[1]) +
+				", length=" + std::to_string(length), [&]() {
+				game.update();
+				game.render();
+			});
+		}
+	}
+
+	game.shutdown();
+}
+
+int main(int argc, char* argv[]) {
+	bool use_sdl = true;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			filter = argv[++i];
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+			min_time = atof(argv[++i]) / 1000.0;
+		else if (strcmp(argv[i], "--no-sdl") == 0)
+			use_sdl = false;
+		else {
+			std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+			return 1;
+		}
+	}
+
+	engine_benchmarks();
+
+	if (use_sdl)
+		sdl_benchmarks();
+	return 0;
+}
\ No newline at end of file
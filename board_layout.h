@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "snek.h"
+#include "occupancy.h"
+
+// where the cells are on the board and which one is next to which. the engine is a template over this (see
+// BasicSnekEngine in engine.h) so the board size can be known at compile time: with FixedBoardLayout every division by
+// the width is a multiplication by a constant, wrapping around an edge is a compare and a conditional move instead of a
+// branch, and the occupancy bits are a std::array instead of a vector. DynamicBoardLayout takes any size at runtime like
+// the engine always did. with_board_layout() picks the fixed layout for the sizes that have one, once, outside of the
+// loop that runs the engine
+
+template <int Width, int Height>
+struct FixedBoardLayout {
+	static_assert(Width >= 2 && Height >= 2, "a board has to be at least 2x2");
+
+	static const bool fixed_size = true;
+	typedef FixedOccupancy<(size_t)Width * Height> Occupancy;
+
+	FixedBoardLayout() {};
+
+	// the size is part of the type, whoever picked this layout already checked it's the right one
+	void resize(int, int) {}
+
+	int width() const {
+		return Width;
+	}
+
+	int height() const {
+		return Height;
+	}
+
+	Cell make_cell(int x, int y) const {
+		return (Cell)(y * Width + x);
+	}
+
+	int cell_x(Cell cell) const {
+		return (int)(cell % (Cell)Width);
+	}
+
+	int cell_y(Cell cell) const {
+		return (int)(cell / (Cell)Width);
+	}
+
+	// the same cell as DynamicBoardLayout::neighbour_cell() works out, straight from the cell number
+	Cell neighbour_cell(Cell cell, NodeDirection dir) const {
+		const Cell last_row = (Cell)(Width * (Height - 1));
+
+		switch (dir) {
+			case NodeDirection::UP:
+				return cell >= (Cell)Width ? cell - Width : cell + last_row;
+			case NodeDirection::DOWN:
+				return cell < last_row ? cell + Width : cell - last_row;
+			case NodeDirection::LEFT:
+				return cell % Width != 0 ? cell - 1 : cell + (Width - 1);
+			case NodeDirection::RIGHT:
+				return cell % Width != Width - 1 ? cell + 1 : cell - (Width - 1);
+			default:
+				return cell;
+		}
+	}
+};
+
+struct DynamicBoardLayout {
+	static const bool fixed_size = false;
+	typedef OccupancyGrid Occupancy;
+
+	int board_width = 20;
+	int board_height = 15;
+
+	DynamicBoardLayout() {};
+
+	void resize(int width, int height) {
+		board_width = width;
+		board_height = height;
+	}
+
+	int width() const {
+		return board_width;
+	}
+
+	int height() const {
+		return board_height;
+	}
+
+	Cell make_cell(int x, int y) const {
+		return (Cell)(y * board_width + x);
+	}
+
+	int cell_x(Cell cell) const {
+		return (int)(cell % board_width);
+	}
+
+	int cell_y(Cell cell) const {
+		return (int)(cell / board_width);
+	}
+
+	// the cell next to the given one, teleporting to the other side if it would be out of bounds
+	Cell neighbour_cell(Cell cell, NodeDirection dir) const {
+		int x = cell_x(cell);
+		int y = cell_y(cell);
+
+		switch (dir) {
+			case NodeDirection::UP:
+				y = (y == 0) ? board_height - 1 : y - 1;
+				break;
+			case NodeDirection::DOWN:
+				y = (y == board_height - 1) ? 0 : y + 1;
+				break;
+			case NodeDirection::LEFT:
+				x = (x == 0) ? board_width - 1 : x - 1;
+				break;
+			case NodeDirection::RIGHT:
+				x = (x == board_width - 1) ? 0 : x + 1;
+				break;
+			default:
+				break;
+		}
+		return make_cell(x, y);
+	}
+};
+
+// calls run(layout) with the fixed layout for the board sizes that have one and the dynamic one otherwise, run is
+// usually a generic lambda that makes a BasicSnekEngine<decltype(layout)>. every fixed size here is another copy of
+// whatever run does, so only the sizes that get played a lot are on the list
+template <class Run>
+void with_board_layout(int width, int height, Run&& run) {
+	if (width == 20 && height == 15)
+		run(FixedBoardLayout<20, 15>()); // the game's board
+	else if (width == 40 && height == 30)
+		run(FixedBoardLayout<40, 30>()); // the game's board doubled, --board 40x30
+	else
+		run(DynamicBoardLayout());
+}
\ No newline at end of file
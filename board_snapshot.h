@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include "engine.h"
+#include "occupancy.h"
+#include "snek.h"
+
+// a copy of what it takes to draw the board, so the renderer can draw one tick while the engine is already working on
+// the next. the snek's body isn't copied, the occupancy bits show where it is and only the head and tail need to be told
+// apart. the bits are only copied again when the engine moved the snek or started a new game since the last capture,
+// which is a few times a second at most, the other ticks only copy the handful of numbers
+
+struct BoardSnapshot {
+	int board_width = 20;
+	int board_height = 15;
+	OccupancyGrid occupancy;
+	Cell head = 0;
+	Cell tail = 0;
+	Cell last_tail = 0;
+	Cell food_cell = 0;
+	int food_variant = 0;
+	NodeDirection current_direction = NodeDirection::UP;
+	uint32_t snek_move_interval = SnekEngine::start_move_interval;
+	uint32_t snek_move_timer = 0;
+	uint32_t time = 0;
+	uint64_t moves = 0;
+	uint32_t generation = 0; // the engine's when the occupancy was copied, with moves it says whether it's stale
+	bool captured = false;
+
+	void capture(const SnekEngine& engine) {
+		if (!captured || generation != engine.generation || moves != engine.moves) {
+			occupancy = engine.occupancy; // keeps its buffer if the board is the same size
+			generation = engine.generation;
+			moves = engine.moves;
+			captured = true;
+		}
+
+		board_width = engine.board_width;
+		board_height = engine.board_height;
+		head = engine.snek.size() > 0 ? engine.snek.head() : 0;
+		tail = engine.snek.size() > 0 ? engine.snek.tail() : 0;
+		last_tail = engine.last_tail;
+		food_cell = engine.food_cell;
+		food_variant = engine.food_variant;
+		current_direction = engine.current_direction;
+		snek_move_interval = engine.snek_move_interval;
+		snek_move_timer = engine.snek_move_timer;
+		time = engine.time;
+	}
+
+	Cell make_cell(int x, int y) const {
+		return (Cell)(y * board_width + x);
+	}
+
+	int cell_x(Cell cell) const {
+		return (int)(cell % board_width);
+	}
+
+	int cell_y(Cell cell) const {
+		return (int)(cell / board_width);
+	}
+};
\ No newline at end of file
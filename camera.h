@@ -0,0 +1,62 @@
+#pragma once
+#include <SDL.h>
+
+// the part of the board that's on screen, in board pixels with (0, 0) at the top left corner of the first cell.
+// it keeps the head in the middle and stops at the board edges, boards smaller than the screen are centered instead
+
+struct Camera {
+	int x = 0;
+	int y = 0;
+	int view_width = 0;
+	int view_height = 0;
+	int board_pixel_width = 0;
+	int board_pixel_height = 0;
+
+	void resize(int view_w, int view_h, int board_w, int board_h) {
+		view_width = view_w;
+		view_height = view_h;
+		board_pixel_width = board_w;
+		board_pixel_height = board_h;
+	}
+
+	// puts the given board pixel as close to the middle of the screen as the board edges allow
+	void follow(int target_x, int target_y) {
+		x = follow_axis(target_x, view_width, board_pixel_width);
+		y = follow_axis(target_y, view_height, board_pixel_height);
+	}
+
+	static int follow_axis(int target, int view, int board) {
+		if (board <= view)
+			return (board - view) / 2; // negative, so the board ends up centered
+
+		int position = target - view / 2;
+		if (position < 0)
+			return 0;
+		if (position > board - view)
+			return board - view;
+		return position;
+	}
+
+	// the tiles that are at least partly on screen, first_* inclusive and last_* exclusive, already clamped to the board
+	void visible_tiles(int tile_size, int board_width, int board_height, int& first_x, int& first_y, int& last_x, int& last_y) const {
+		first_x = x > 0 ? x / tile_size : 0;
+		first_y = y > 0 ? y / tile_size : 0;
+		last_x = (x + view_width + tile_size - 1) / tile_size;
+		last_y = (y + view_height + tile_size - 1) / tile_size;
+
+		if (last_x > board_width)
+			last_x = board_width;
+		if (last_y > board_height)
+			last_y = board_height;
+	}
+
+	// most tiles visible_tiles() can return, for sizing buffers up front
+	int max_visible_tiles(int tile_size) const {
+		return (view_width / tile_size + 2) * (view_height / tile_size + 2);
+	}
+
+	SDL_Rect to_screen(int board_x, int board_y, int w, int h) const {
+		SDL_Rect rect = { board_x - x, board_y - y, w, h };
+		return rect;
+	}
+};
\ No newline at end of file
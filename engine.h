@@ -0,0 +1,288 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include "snek.h"
+#include "occupancy.h"
+#include "board_layout.h"
+#include "rng.h"
+
+// the snek rules on their own, without SDL. everything works on board cells and simulation milliseconds,
+// and anything the front-end should react to (sounds, text, switching screens) comes back as EngineEvent flags.
+// after reset() nothing here allocates, so the headless runner can push millions of ticks through it.
+// the board's geometry comes from Layout (see board_layout.h), SnekEngine takes any size at runtime and
+// BasicSnekEngine<FixedBoardLayout<w, h>> is the same rules compiled for one size
+
+enum EngineEvent : unsigned int {
+	ENGINE_NONE = 0,
+	ENGINE_MOVED = 1 << 0,
+	ENGINE_ATE_FOOD = 1 << 1,
+	ENGINE_DIED = 1 << 2
+};
+
+// everything about a game except the snek's body past its head, as plain data that can be copied around as bytes.
+// the body is snek_length cells from the head, whoever saves a game keeps those however suits it (see rewind.h)
+struct EngineState {
+	int32_t board_width = 0;
+	int32_t board_height = 0;
+	Pcg32 rng;
+	NodeDirection current_direction = NodeDirection::UP;
+	Cell head = 0;
+	uint32_t snek_length = 0;
+	Cell food_cell = 0;
+	int32_t food_variant = 0;
+	bool alive = false;
+	uint32_t foods_eaten = 0;
+	uint32_t score = 0;
+	uint32_t snek_move_interval = 0;
+	uint32_t snek_move_timer = 0;
+	uint32_t time = 0;
+	uint64_t tick_count = 0;
+	uint64_t moves = 0;
+	Cell last_tail = 0;
+};
+
+static_assert(std::is_trivially_copyable<EngineState>::value, "EngineState gets copied around as bytes");
+
+template <class Layout>
+class BasicSnekEngine {
+	public:
+		static const uint32_t tick_interval = 5; // ms of simulation per tick
+		static const uint32_t start_move_interval = 1000;
+		static const uint32_t min_move_interval = 50;
+		static const int food_variant_count = 4; // how many food sprites the front-end has to pick from
+
+		Layout layout;
+		int board_width = 20; // the same as the layout's, for whoever doesn't care which layout it is
+		int board_height = 15;
+
+		SnekBody snek;
+		typename Layout::Occupancy occupancy; // which cells the snek is on
+		Pcg32 rng;
+
+		NodeDirection current_direction = NodeDirection::UP;
+		Cell food_cell = 0;
+		int food_variant = 0;
+		bool alive = false;
+
+		unsigned int foods_eaten = 0;
+		unsigned int score = 0;
+
+		uint32_t snek_move_interval = start_move_interval;
+		uint32_t snek_move_timer = 0;
+		uint32_t time = 0; // ms of simulation since reset()
+		uint64_t tick_count = 0;
+		uint64_t moves = 0;
+		Cell last_tail = 0; // the cell the last move left, the tail itself if it didn't leave one
+		uint32_t generation = 0; // counts reset()s, so a copy of the board can tell it's from another game
+
+		BasicSnekEngine() {};
+
+		// starts a new game, the buffers are only reallocated if the board size changed
+		void reset(int width, int height, uint64_t seed) {
+			layout.resize(width, height);
+			board_width = layout.width();
+			board_height = layout.height();
+			rng.seed(seed);
+
+			size_t cells = (size_t)board_width * board_height;
+			snek.reset(cells, make_cell(board_width * 2 / 5, board_height / 2));
+			occupancy.reset(cells);
+			occupancy.set(snek.head());
+
+			current_direction = NodeDirection::UP;
+			alive = true;
+			foods_eaten = 0;
+			score = 0;
+			snek_move_interval = start_move_interval;
+			snek_move_timer = 0;
+			time = 0;
+			tick_count = 0;
+			moves = 0;
+			last_tail = snek.tail();
+			generation++;
+
+			spawn_food();
+		}
+
+		void save_state(EngineState& state) const {
+			state.board_width = board_width;
+			state.board_height = board_height;
+			state.rng = rng;
+			state.current_direction = current_direction;
+			state.head = snek.head();
+			state.snek_length = (uint32_t)snek.size();
+			state.food_cell = food_cell;
+			state.food_variant = food_variant;
+			state.alive = alive;
+			state.foods_eaten = foods_eaten;
+			state.score = score;
+			state.snek_move_interval = snek_move_interval;
+			state.snek_move_timer = snek_move_timer;
+			state.time = time;
+			state.tick_count = tick_count;
+			state.moves = moves;
+			state.last_tail = last_tail;
+		}
+
+		// puts the game back the way save_state() found it, body(i) gives the i-th segment from the head for i from 1
+		// to snek_length - 1 in that order. counts as a new game for generation, it's a different board all of a sudden
+		template <class Body>
+		void restore_state(const EngineState& state, Body&& body) {
+			layout.resize(state.board_width, state.board_height);
+			board_width = layout.width();
+			board_height = layout.height();
+
+			size_t cells = (size_t)board_width * board_height;
+			snek.reset(cells, state.head);
+			occupancy.reset(cells);
+			occupancy.set(state.head);
+			for (uint32_t i = 1; i < state.snek_length; i++) {
+				Cell cell = body(i);
+				snek.push_tail(cell);
+				occupancy.set(cell);
+			}
+
+			rng = state.rng;
+			current_direction = state.current_direction;
+			food_cell = state.food_cell;
+			food_variant = state.food_variant;
+			alive = state.alive;
+			foods_eaten = state.foods_eaten;
+			score = state.score;
+			snek_move_interval = state.snek_move_interval;
+			snek_move_timer = state.snek_move_timer;
+			time = state.time;
+			tick_count = state.tick_count;
+			moves = state.moves;
+			last_tail = state.last_tail;
+			generation++;
+		}
+
+		// advances the simulation by one tick_interval, moving the snek whenever its move timer runs out
+		unsigned int tick() {
+			time += tick_interval;
+			tick_count++;
+
+			if (alive && time - snek_move_timer >= snek_move_interval) { // automatic snek movement
+				snek_move_timer = time;
+				return move_snek();
+			}
+			return ENGINE_NONE;
+		}
+
+		// a sideways turn moves the snek right away and restarts the move timer, turning back on itself or going the same way does nothing
+		unsigned int turn(NodeDirection dir) {
+			if (!alive || !can_turn(dir))
+				return ENGINE_NONE;
+
+			current_direction = dir;
+			snek_move_timer = time;
+			return move_snek();
+		}
+
+		bool can_turn(NodeDirection dir) const {
+			bool vertical = current_direction == NodeDirection::UP || current_direction == NodeDirection::DOWN;
+			if (dir == NodeDirection::UP || dir == NodeDirection::DOWN)
+				return !vertical;
+			if (dir == NodeDirection::LEFT || dir == NodeDirection::RIGHT)
+				return vertical;
+			return false;
+		}
+
+		unsigned int move_snek() {
+			// every segment follows the one in front of it, so only the two ends of the snek actually change
+			Cell new_head = neighbour_cell(snek.head(), current_direction);
+
+			Cell old_tail = snek.tail();
+			last_tail = old_tail;
+			moves++;
+			snek.pop_tail();
+			if (snek.size() == 0 || snek.tail() != old_tail) // a freshly grown tail can share the cell with the one before it
+				occupancy.clear(old_tail);
+
+			if (occupancy.test(new_head)) { // snek self collusion
+				snek.push_head(new_head);
+				alive = false;
+				return ENGINE_MOVED | ENGINE_DIED;
+			}
+
+			snek.push_head(new_head);
+			occupancy.set(new_head);
+
+			return ENGINE_MOVED | check_food_eat();
+		}
+
+		unsigned int check_food_eat() {
+			if (snek.head() != food_cell)
+				return ENGINE_NONE;
+
+			foods_eaten++;
+			score += foods_eaten * 10;
+
+			if (snek_move_interval != min_move_interval)
+				snek_move_interval -= 50;
+
+			create_new_snek_node();
+			spawn_food();
+			return ENGINE_ATE_FOOD;
+		}
+
+		void create_new_snek_node() {
+			if (snek.full())
+				return;
+
+			Cell last = snek.tail();
+			NodeDirection grow_direction = NodeDirection::DUMMY_VALUE;
+
+			if (snek.size() >= 2) {
+				// keep going in the direction the last two segments are lined up in
+				Cell one_before_last = snek.at(snek.size() - 2);
+				const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+
+				for (NodeDirection dir : directions) {
+					if (neighbour_cell(one_before_last, dir) == last) {
+						grow_direction = dir;
+						break;
+					}
+				}
+			}
+			else
+				grow_direction = opposite(current_direction);
+
+			Cell new_tail = neighbour_cell(last, grow_direction);
+			if (occupancy.test(new_tail))
+				new_tail = last; // no room behind the tail, so the new segment stacks on it and unfolds on the next move
+
+			snek.push_tail(new_tail);
+			occupancy.set(new_tail);
+		}
+
+		void spawn_food() {
+			size_t free_cells = occupancy.free_count();
+			if (free_cells == 0)
+				return; // nowhere left to put it
+
+			// pick one of the free cells directly, this takes the same time no matter how full the board is
+			food_cell = occupancy.nth_free(rng.bounded((uint32_t)free_cells));
+			food_variant = rng.range(0, food_variant_count - 1);
+		}
+
+		Cell make_cell(int x, int y) const {
+			return layout.make_cell(x, y);
+		}
+
+		int cell_x(Cell cell) const {
+			return layout.cell_x(cell);
+		}
+
+		int cell_y(Cell cell) const {
+			return layout.cell_y(cell);
+		}
+
+		// the cell next to the given one, teleporting to the other side if it would be out of bounds
+		Cell neighbour_cell(Cell cell, NodeDirection dir) const {
+			return layout.neighbour_cell(cell, dir);
+		}
+};
+
+typedef BasicSnekEngine<DynamicBoardLayout> SnekEngine;
\ No newline at end of file
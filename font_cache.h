@@ -0,0 +1,163 @@
+#pragma once
+#include <iostream>
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include "texture_cache.h"
+#include "asset_pack.h"
+
+// every (font, size) pair gets opened once and has its printable ascii glyphs rasterised into a single white texture.
+// text is then drawn glyph by glyph out of that texture and coloured with texture colour modulation
+
+struct Glyph {
+	SDL_Rect src = { 0, 0, 0, 0 }; // where the glyph lives in the atlas
+	int advance = 0; // how far the pen moves after drawing it
+};
+
+class GlyphAtlas {
+	public:
+		static const int first_char = 32; // ' '
+		static const int last_char = 126; // '~'
+		static const int columns = 16;
+
+		TextureHandle texture;
+		Glyph glyphs[last_char - first_char + 1];
+		int line_height = 0;
+
+		GlyphAtlas() {};
+
+		bool build(TTF_Font* font, SDL_Renderer* renderer, TextureCache& texture_cache) {
+			SNEK_PROFILE_ZONE("GlyphAtlas::build");
+			const SDL_Colour white = { 255, 255, 255, 255 };
+			const int glyph_count = last_char - first_char + 1;
+			SDL_Surface* rendered[glyph_count] = {};
+
+			line_height = TTF_FontHeight(font);
+			int cell_w = 1, cell_h = line_height;
+
+			for (int i = 0; i < glyph_count; i++) {
+				Uint16 ch = (Uint16)(first_char + i);
+				TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &glyphs[i].advance);
+
+				// solid rendering keeps the pixel font crisp, converting it gives us an alpha channel where the colour key was
+				SDL_Surface* solid = TTF_RenderGlyph_Solid(font, ch, white);
+				if (solid == NULL)
+					continue;
+				rendered[i] = SDL_ConvertSurfaceFormat(solid, SDL_PIXELFORMAT_RGBA32, 0);
+				SDL_FreeSurface(solid);
+
+				if (rendered[i] != NULL) {
+					if (rendered[i]->w > cell_w) cell_w = rendered[i]->w;
+					if (rendered[i]->h > cell_h) cell_h = rendered[i]->h;
+				}
+			}
+
+			int rows = (glyph_count + columns - 1) / columns;
+			SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, cell_w * columns, cell_h * rows, 32, SDL_PIXELFORMAT_RGBA32);
+
+			for (int i = 0; i < glyph_count; i++) {
+				if (rendered[i] == NULL)
+					continue;
+
+				if (sheet != NULL) {
+					SDL_Rect dst = { (i % columns) * cell_w, (i / columns) * cell_h, rendered[i]->w, rendered[i]->h };
+					SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE); // copy the alpha as is
+					SDL_BlitSurface(rendered[i], NULL, sheet, &dst);
+					glyphs[i].src = dst;
+				}
+				SDL_FreeSurface(rendered[i]);
+			}
+
+			if (sheet == NULL) {
+				std::cerr << "failed to create glyph atlas surface, error: " << SDL_GetError() << std::endl;
+				return false;
+			}
+
+			texture = texture_cache.adopt(SDL_CreateTextureFromSurface(renderer, sheet));
+			SDL_FreeSurface(sheet);
+
+			if (texture == nullptr) {
+				std::cerr << "failed to upload glyph atlas, error: " << SDL_GetError() << std::endl;
+				return false;
+			}
+			SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+			return true;
+		}
+
+		const Glyph* glyph(char ch) const {
+			if (ch < first_char || ch > last_char)
+				return nullptr;
+			return &glyphs[ch - first_char];
+		}
+
+		int measure(const char* str) const {
+			int width = 0;
+			for (; *str != '\0'; str++) {
+				if (const Glyph* g = glyph(*str))
+					width += g->advance;
+			}
+			return width;
+		}
+};
+
+class FontCache {
+	private:
+		struct Entry {
+			TTF_Font* font = nullptr;
+			GlyphAtlas atlas;
+		};
+
+		TextureCache& texture_cache;
+		std::map<std::pair<std::string, int>, std::unique_ptr<Entry>> entries;
+
+	public:
+		const AssetPack* pack = nullptr; // fonts are read out of it if they're in there, it has to stay open while they are
+
+		explicit FontCache(TextureCache& textures) : texture_cache(textures) {};
+
+		FontCache(const FontCache&) = delete;
+		FontCache& operator=(const FontCache&) = delete;
+
+		~FontCache() {
+			release_all();
+		}
+
+		// opens the font and builds its atlas the first time a (font, size) pair is asked for, returns nullptr if that failed
+		GlyphAtlas* get(SDL_Renderer* renderer, const char* font_file, int size) {
+			auto key = std::make_pair(std::string(font_file), size);
+			auto found = entries.find(key);
+			if (found != entries.end())
+				return found->second->font != nullptr ? &found->second->atlas : nullptr;
+
+			std::unique_ptr<Entry> entry(new Entry());
+			SDL_RWops* packed = pack != nullptr ? pack->open_file(font_file) : nullptr;
+			entry->font = packed != nullptr ? TTF_OpenFontRW(packed, 1, size) : TTF_OpenFont(font_file, size);
+
+			if (entry->font == NULL)
+				std::cerr << "failed to open font file \"" << font_file << "\", error: " << TTF_GetError() << std::endl;
+			else if (!entry->atlas.build(entry->font, renderer, texture_cache)) {
+				TTF_CloseFont(entry->font);
+				entry->font = nullptr;
+			}
+
+			GlyphAtlas* atlas = entry->font != nullptr ? &entry->atlas : nullptr;
+			entries[key] = std::move(entry); // failures are remembered too so we don't retry every frame
+			return atlas;
+		}
+
+		size_t font_count() const {
+			return entries.size();
+		}
+
+		// closes every font, has to be called before TTF_Quit()
+		void release_all() {
+			for (auto& entry : entries) {
+				if (entry.second->font != nullptr)
+					TTF_CloseFont(entry.second->font);
+			}
+			entries.clear();
+		}
+};
\ No newline at end of file
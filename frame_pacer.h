@@ -0,0 +1,107 @@
+#pragma once
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// presents frames at a steady rate of our own instead of whatever vsync gives, and measures how steady it really was.
+// SDL_Delay() can oversleep by a millisecond or more, so it only sleeps until shortly before the frame is due and
+// spins for the rest. frames are scheduled on a fixed grid from the first one, so one late frame doesn't push every
+// frame after it back. the frame times it reports are the gaps between presents while frames came one after another,
+// the pauses while nothing on screen changed aren't frames
+
+class FramePacer {
+	private:
+		static const size_t max_samples = 1 << 14; // the oldest are overwritten after that
+
+		Uint64 frequency = 1;
+		Uint64 period = 0; // performance counter ticks per frame, 0 when not pacing
+		Uint64 next_frame = 0;
+		Uint64 last_present = 0;
+		Uint64 spin_margin = 0;
+		std::vector<double> samples; // ms between presents, used as a ring once full
+		size_t next_sample = 0;
+
+	public:
+		int target_fps = 0; // 0 doesn't wait at all and only measures
+		unsigned long long late_frames = 0; // frames that missed their slot on the grid
+
+		FramePacer() {};
+
+		void start() {
+			frequency = SDL_GetPerformanceFrequency();
+			period = target_fps > 0 ? frequency / target_fps : 0;
+			spin_margin = frequency * 3 / 2000; // 1.5 ms
+			next_frame = 0;
+			last_present = 0;
+			samples.reserve(max_samples);
+			samples.clear();
+			next_sample = 0;
+		}
+
+		// waits until the next frame is due, right before drawing it
+		void wait() {
+			if (period == 0)
+				return;
+
+			Uint64 now = SDL_GetPerformanceCounter();
+			if (next_frame == 0 || now > next_frame + period) {
+				if (last_present != 0 && now - last_present < period * 3)
+					late_frames++; // missed a whole slot while drawing one frame after another, not just back from a pause
+				next_frame = now; // the grid starts over from here
+				return;
+			}
+
+			if (next_frame > now + spin_margin)
+				SDL_Delay((Uint32)((next_frame - now - spin_margin) * 1000 / frequency));
+			while (SDL_GetPerformanceCounter() < next_frame)
+				; // the last bit is too short to trust the scheduler with
+		}
+
+		// right after SDL_RenderPresent() returned
+		void presented() {
+			Uint64 now = SDL_GetPerformanceCounter();
+			Uint64 gap_limit = (period > 0 ? period : frequency / 60) * 3; // longer than this was an idle pause, not a frame
+
+			if (last_present != 0 && now - last_present < gap_limit) {
+				double ms = (double)(now - last_present) * 1000.0 / frequency;
+				if (samples.size() < max_samples)
+					samples.push_back(ms);
+				else {
+					samples[next_sample] = ms;
+					next_sample = (next_sample + 1) % max_samples;
+				}
+			}
+			last_present = now;
+
+			if (period > 0)
+				next_frame += period;
+		}
+
+		void report(std::ostream& out) const {
+			if (samples.empty()) {
+				out << "frame pacing: no consecutive frames" << std::endl;
+				return;
+			}
+
+			double sum = 0.0;
+			for (double ms : samples)
+				sum += ms;
+			double mean = sum / samples.size();
+
+			double variance = 0.0;
+			for (double ms : samples)
+				variance += (ms - mean) * (ms - mean);
+			variance /= samples.size();
+
+			std::vector<double> sorted(samples);
+			std::sort(sorted.begin(), sorted.end());
+
+			out << "frame pacing";
+			if (target_fps > 0)
+				out << " (target " << target_fps << " fps)";
+			out << " over " << samples.size() << " frames: mean " << mean << " ms, stddev " << std::sqrt(variance) << " ms (variance " << variance
+				<< "), p99 " << sorted[(size_t)(0.99 * (sorted.size() - 1))] << " ms, max " << sorted.back() << " ms, " << late_frames << " late" << std::endl;
+		}
+};
\ No newline at end of file
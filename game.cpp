@@ -3,7 +3,10 @@
 #include <SDL_image.h>
 #include <SDL_ttf.h>
 #include <iostream>
+#include <cstdio>
 #include <random>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <sstream>
 #include <iterator>
@@ -12,17 +15,81 @@
 #include "text.h"
 #include "snek.h"
 
-Game::Game() {
+Game::Game(const GameOptions& options) {
+	startup_counter = SDL_GetPerformanceCounter();
+
+	// seed the generator once, either with the seed we were given or with some real entropy
+	if (options.has_seed)
+		seed = options.seed;
+	else {
+		std::random_device rand;
+		seed = ((uint64_t)rand() << 32) | rand();
+	}
+	rng.seed(seed);
+	attract_rng.seed(seed, 0x5eed); // another stream of the same seed
+	vsync = options.vsync && !options.offscreen;
+	late_input = options.late_input && !options.threaded;
+	measure_latency = options.measure_latency;
+	smooth = options.smooth;
+	pacer.target_fps = options.target_fps;
+	threaded = options.threaded;
+	if (options.late_input && options.threaded) // the input goes to another thread, waiting for the vblank here wouldn't get it into the frame
+		std::cerr << "--low-latency doesn't work with --threaded and is ignored" << std::endl;
+	autopilot_on = options.autopilot;
+	autopilot.budget_us = options.autopilot_budget_us;
+	board_width = options.board_width;
+	board_height = options.board_height;
+	rewind.configure((size_t)options.rewind_memory_kb * 1024);
+	std::clog << "seed: " << seed << std::endl; // pass this to --seed to get the same food again
+
+	// a replay brings its own board and seeds, and nothing gets recorded while it plays
+	if (options.replay_path != nullptr) {
+		if (replay.open(options.replay_path) && !replay.games.empty()) {
+			replaying = true;
+			replay_speed = options.replay_speed;
+			board_width = replay.board_width;
+			board_height = replay.board_height;
+			autopilot_on = false;
+			std::clog << "replaying " << replay.games.size() << " games, " << replay.total_turns() << " turns in " << replay.size() << " bytes" << std::endl;
+		}
+		else
+			std::cerr << "couldn't read the replay \"" << options.replay_path << "\"" << std::endl;
+	}
+	else if (options.record_path != nullptr) {
+		record_path = options.record_path;
+		if (!recorder.open(record_path, board_width, board_height))
+			std::cerr << "couldn't open \"" << record_path << "\" to record the session" << std::endl;
+	}
+
+	// the asset pack if there is one, for development the loose files work just as well
+	if (options.pack_path != nullptr && pack.open(options.pack_path)) {
+		textures.pack = &pack;
+		fonts.pack = &pack;
+		assets.pack = &pack;
+		std::clog << "assets from \"" << options.pack_path << "\" (" << pack.entry_count() << " files, " << pack.size() / 1024 << " KB)" << std::endl;
+	}
+	else
+		std::clog << "no asset pack, loading the loose files" << std::endl;
+
+	if (options.offscreen) {
+		// no display or sound card needed, unless the environment already picked drivers
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+	}
+
 	// initialize SDL
 	if (SDL_Init((SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0))
 		std::cerr << "failed to initialize SDL: " << SDL_GetError() << std::endl;
 	else {
-		window = SDL_CreateWindow(window_title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+		window = SDL_CreateWindow(window_title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, options.offscreen ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
 		if (window == NULL)
 			std::cerr << "window couldn't be created: " << SDL_GetError() << std::endl;
 		else {
 			// initialize renderer
-			game_renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC); // vsync on
+			Uint32 renderer_flags = options.offscreen ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED;
+			if (vsync)
+				renderer_flags |= SDL_RENDERER_PRESENTVSYNC; // without it frames go out as soon as they're drawn, tearing included
+			game_renderer = SDL_CreateRenderer(window, -1, renderer_flags);
 			if (game_renderer == NULL)
 				std::cerr << "renderer couldn't be created: " << SDL_GetError() << std::endl;
 			else {
@@ -39,32 +106,56 @@ Game::Game() {
 						std::cerr << "SDL_ttf couldn't initialize: " << IMG_GetError() << std::endl;
 					else {
 						// initialize audio
-						if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
+						if (Mix_OpenAudio(AssetPack::sound_frequency, AssetPack::sound_format, AssetPack::sound_channels, 2048) < 0)
 							std::cerr << "SDL_mixer couldn't initialize: " << Mix_GetError() << std::endl;
 						else {
-							// now that we successfully initialized everything, we load some textures and audio and then set the game_state to main menu
-							menu_image = { "sprites/menu.png", game_renderer, textures, 0, 0 };
-							instructions_image = { "sprites/instructions.png", game_renderer, textures, 0, 0 };
-							start_text = { "press a snek", game_renderer, textures, 400, 400 };
-							grid = { "sprites/grid.png", game_renderer, textures, 0, 0 };
-							congratulations_image = { "sprites/end.png", game_renderer, textures, 0, 0 };
-							sound_on_sprite = { "sprites/sound_on.png", game_renderer, textures, 0, SCREEN_HEIGHT - 50 };
-							sound_off_sprite = { "sprites/sound_off.png", game_renderer, textures, 0, SCREEN_HEIGHT - 50 };
-							github_logo_sprite = { "sprites/github_logo.png", game_renderer, textures, 60, SCREEN_HEIGHT - 50 };
+							// now that we successfully initialized everything, the images and audio get loaded in the background. the menu's
+							// come first and the menu shows up as soon as they're in, the rest keeps loading behind it (see receive_assets())
+							menu_image_asset = assets.add("sprites/menu.png", AssetKind::IMAGE);
+							assets.add("sprites/sound_on.png", AssetKind::IMAGE);
+							assets.add("sprites/sound_off.png", AssetKind::IMAGE);
+							assets.add("sprites/github_logo.png", AssetKind::IMAGE);
+							menu_music_asset = assets.add("music/menu_music.wav", AssetKind::MUSIC);
+							menu_batch = assets.end_batch();
 
-							restart_game_text = { "Press ENTER to restart the game!", game_renderer, textures, 200, 490, 20 };
-							exit_game_text = { "Press ESC to exit snek (makes snek sad) :c", game_renderer, textures, 190, 600, 18 };
-							you_won_text = { "YOU HECKIN WON!!!", game_renderer, textures, 250, 300, 40 };
+							instructions_image_asset = assets.add("sprites/instructions.png", AssetKind::IMAGE);
+							assets.add("sprites/end.png", AssetKind::IMAGE);
+							first_board_asset = assets.size();
+							for (const char* path : board_sprites)
+								assets.add(path, AssetKind::IMAGE);
+							collect_sfx_asset = assets.add("sfx/collect.wav", AssetKind::SOUND);
+							end_sfx_asset = assets.add("sfx/end.wav", AssetKind::SOUND);
+							ingame_music_asset = assets.add("music/ingame_music.wav", AssetKind::MUSIC);
+							assets.end_batch();
+							assets.start();
 
-							menu_music = Mix_LoadMUS("music/menu_music.wav");
-							ingame_music = Mix_LoadMUS("music/ingame_music.wav");
+							// the fonts get rasterised here in the meantime
+							start_text = { "press a snek", game_renderer, fonts, 400, 400 };
+							restart_game_text = { "Press ENTER to restart the game!", game_renderer, fonts, 200, 490, 20 };
+							exit_game_text = { "Press ESC to exit snek (makes snek sad) :c", game_renderer, fonts, 190, 600, 18 };
+							you_won_text = { "YOU HECKIN WON!!!", game_renderer, fonts, 250, 300, 40 };
+							score_text = { "Score: 0", game_renderer, fonts, 10, SCREEN_HEIGHT - 30 };
+							end_score_text = { "Your score: 0", game_renderer, fonts, 200, 400 };
 
-							collect_sfx = Mix_LoadWAV("sfx/collect.wav");
-							end_sfx = Mix_LoadWAV("sfx/end.wav");
+							SDL_DisplayMode display_mode;
+							if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &display_mode) == 0 && display_mode.refresh_rate > 0)
+								redraw.refresh_rate = display_mode.refresh_rate;
+							redraw.always_redraw = options.always_redraw;
 
-							Mix_PlayMusic(menu_music, -1);
+#ifdef SNEK_PROFILER
+							for (int i = 0; i < 4; i++)
+								hud_text[i] = { "", game_renderer, fonts, 5, 5 + i * 14, 12, { 255, 0, 0 } };
+							if (options.trace_path != nullptr) {
+								trace_path = options.trace_path;
+								trace_on_exit = true;
+							}
+#else
+							if (options.trace_path != nullptr)
+								std::cerr << "--trace needs a build with SNEK_PROFILER defined" << std::endl;
+#endif
 
-							game_state = GameState::GAME_MENU;
+							replay_seek = options.replay_seek;
+							game_state = GameState::GAME_LOADING; // until the menu's assets are in
 						}
 					}
 				}
@@ -73,15 +164,28 @@ Game::Game() {
 	}
 }
 
+// the main loop (or the simulation thread) stops after this, run() cleans up once it's out of it
 void Game::quit() {
 	game_state = GameState::GAME_QUIT;
+}
 
-	// free the memory from all the loaded textures
-	for (SDL_Texture *texture : textures) {
-		SDL_DestroyTexture(texture);
-		texture = nullptr;
+void Game::shutdown() {
+	audio.stop(); // nothing plays from another thread once the chunks are freed below
+	assets.release_all(); // waits for the loader, which might still be using SDL_mixer
+	if (recorder.is_open()) {
+		recorder.close(engine.tick_count, engine.score); // a game that's still going is kept up to here
+		std::clog << "recorded " << recorder.turns_written << " turns in " << recorder.bytes_written << " bytes to \"" << record_path << "\"" << std::endl;
 	}
 
+	game_state = GameState::GAME_QUIT;
+
+	// free the memory from all the loaded textures, anything still alive after every holder let go is freed regardless
+	size_t leaked = release_textures();
+	if (leaked > 0)
+		std::clog << leaked << " textures were still alive after everything holding one let go" << std::endl;
+	textures.release_all();
+	fonts.release_all();
+
 	SDL_DestroyRenderer(game_renderer);
 	SDL_DestroyWindow(window);
 	
@@ -97,262 +201,559 @@ void Game::quit() {
 	SDL_Quit();
 }
 
-void Game::initialize_game() {
-	if (snek_nodes.size() > 0)
-		snek_nodes.clear();
+// lets go of every texture handle the game holds, the fonts' atlases included, and returns how many textures the cache
+// still has alive after that. anything left over is held somewhere the game doesn't know about
+size_t Game::release_textures() {
+	Sprite* sprites[] = { &menu_image, &sound_on_sprite, &sound_off_sprite, &github_logo_sprite, &instructions_image, &congratulations_image };
+	for (Sprite* sprite : sprites)
+		*sprite = Sprite();
 
-	SnekNode head = { "sprites/snek_head.png", game_renderer, textures, 400, 350 };
-	snek_nodes.emplace_back(head);
+	Text* texts[] = { &start_text, &score_text, &you_won_text, &end_score_text, &restart_game_text, &exit_game_text };
+	for (Text* text : texts)
+		*text = Text(); // their atlases go with the fonts
+#ifdef SNEK_PROFILER
+	for (Text& text : hud_text)
+		text = Text();
+#endif
 
-	if (sound_on) {
-		if (Mix_PlayingMusic() == 1)
-			Mix_HaltMusic();
-		Mix_PlayMusic(ingame_music, -1);
+	board_atlas.texture.reset();
+	preloaded.clear();
+	fonts.release_all();
+	return textures.texture_count();
+}
+
+void Game::initialize_game() {
+	finish_loading();
+
+	if (replaying)
+		replay_player.start(replay, replay_game, engine); // the recorded seed
+	else {
+		uint64_t game_seed = ((uint64_t)rng.next() << 32) | rng.next();
+		engine.reset(board_width, board_height, game_seed); // only allocates the first time
+		recorder.begin_game(game_seed);
+		rewind.clear();
+		rewind.record_tick(engine);
 	}
 
+	if (sound_on)
+		play_music(ingame_music); // stops the menu music
+
 	// reset game vars
-	score = 0;
-	foods_eaten = 0;
-	snek_move_interval = 1000;
 	last_speed_increase = 0;
-
-	score_text = { "Score: 0", game_renderer, textures, 10, SCREEN_HEIGHT - 30 };
-
-	spawn_food();
 }
 
+// the sounds go to the audio thread while the simulation has a thread of its own, it's never kept waiting by SDL_mixer then
 void Game::play_if_sound_on(Mix_Chunk *sfx, int loops=0) {
-	if (sound_on)
+	if (!sound_on)
+		return;
+
+	if (audio.running())
+		audio.submit({ AudioCommandType::PLAY_SOUND, sfx, nullptr, loops });
+	else
 		Mix_PlayChannel(-1, sfx, loops);
 }
 
-void Game::check_food_eat() {
-	if (SDL_HasIntersection(&snek_nodes[0].node_sprite.rect, &food.rect)) { // stuff that happens when snek eats food
-		foods_eaten++;
+void Game::play_music(Mix_Music* music) {
+	if (audio.running())
+		audio.submit({ AudioCommandType::PLAY_MUSIC, nullptr, music, -1 });
+	else
+		Mix_PlayMusic(music, -1);
+}
 
-		play_if_sound_on(collect_sfx);
+void Game::halt_music() {
+	if (audio.running())
+		audio.submit({ AudioCommandType::HALT_MUSIC });
+	else
+		Mix_HaltMusic();
+}
 
-		score += foods_eaten * 10;
-		score_text_stream << "Score: " << score;
-		score_text = { score_text_stream.str(), game_renderer, textures, 10, SCREEN_HEIGHT - 30 };
-		score_text_stream.str(std::string()); // empty the string stream
+// takes what the loader finished since the last call, a batch at a time. the gpu uploads happen here since the renderer
+// only works on this thread, everything else was done by the workers
+void Game::receive_assets() {
+	if (!menu_assets_ready && assets.batch_loaded(menu_batch)) {
+		upload_images(menu_image_asset, menu_music_asset);
+		menu_image = { "sprites/menu.png", game_renderer, textures, 0, 0 }; // the textures are in the cache already
+		sound_on_sprite = { "sprites/sound_on.png", game_renderer, textures, 0, SCREEN_HEIGHT - 50 };
+		sound_off_sprite = { "sprites/sound_off.png", game_renderer, textures, 0, SCREEN_HEIGHT - 50 };
+		github_logo_sprite = { "sprites/github_logo.png", game_renderer, textures, 60, SCREEN_HEIGHT - 50 };
+		menu_music = assets.get(menu_music_asset).music;
+		assets.get(menu_music_asset).music = nullptr;
 
-		if (snek_move_interval != 50) {
-			snek_move_interval -= 50;
+		menu_assets_ready = true;
+		std::clog << "menu ready after " << (SDL_GetPerformanceCounter() - startup_counter) * 1000 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+
+		if (replaying) { // straight into the game, which needs everything
+			finish_loading();
+			game_state = GameState::GAME_ACTIVE;
+			seek_replay(replay_seek);
+		}
+		else {
+			game_state = GameState::GAME_MENU;
+			last_input_time = sim_time; // the demo waits for the menu to be up for a while, not the loading
+			play_music(menu_music);
 		}
-		SDL_DestroyTexture(food.texture);
-		food.texture = nullptr;
+		redraw.invalidate();
+	}
+
+	if (menu_assets_ready && !all_assets_ready && assets.all_loaded()) {
+		upload_images(instructions_image_asset, first_board_asset);
+		instructions_image = { "sprites/instructions.png", game_renderer, textures, 0, 0 };
+		congratulations_image = { "sprites/end.png", game_renderer, textures, 0, 0 };
+
+		std::vector<SDL_Surface*> board_images;
+		for (size_t i = 0; i < board_sprites.size(); i++) {
+			board_images.push_back(assets.get(first_board_asset + i).surface);
+			assets.get(first_board_asset + i).surface = nullptr;
+		}
+		board_atlas.build_from_images(game_renderer, textures, board_images);
+
+		// grid.png is one screen's worth of tiles, bigger boards repeat it
+		const SDL_Rect& grid_region = board_atlas.region(ATLAS_GRID);
+		grid_chunk_width = grid_region.w / tile_size > 0 ? grid_region.w / tile_size : 1;
+		grid_chunk_height = grid_region.h / tile_size > 0 ? grid_region.h / tile_size : 1;
 
-		create_new_snek_node();
-		spawn_food();
+		// only what's on screen goes into the batch, so it's sized by the window and not by the board
+		camera.resize(SCREEN_WIDTH, SCREEN_HEIGHT, board_width * tile_size, board_height * tile_size);
+		int max_tiles = camera.max_visible_tiles(tile_size);
+		int max_chunks = (SCREEN_WIDTH / (grid_chunk_width * tile_size) + 2) * (SCREEN_HEIGHT / (grid_chunk_height * tile_size) + 2);
+		// the visible snek, the grid chunks and the food, and the head and sliding tail can each be cut into up to four
+		// pieces by add_wrapped() where they cross the board's edges
+		board_batch.reserve(max_tiles + max_chunks + 1 + 2 * 4);
+
+		collect_sfx = assets.get(collect_sfx_asset).chunk;
+		end_sfx = assets.get(end_sfx_asset).chunk;
+		ingame_music = assets.get(ingame_music_asset).music;
+		assets.get(collect_sfx_asset).chunk = nullptr;
+		assets.get(end_sfx_asset).chunk = nullptr;
+		assets.get(ingame_music_asset).music = nullptr;
+
+		preloaded.clear(); // the sprites hold on to their textures now
+		all_assets_ready = true;
+		std::clog << "all assets loaded after " << (SDL_GetPerformanceCounter() - startup_counter) * 1000 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
 	}
 }
 
-void Game::move_snek() {
-	SDL_Rect rect = snek_nodes[0].node_sprite.rect;
-	int index = 0;
-	
-	for (auto&& node : snek_nodes) {
-		if (index == 0) {
-			node.move(current_direction);
-			index++;
-			continue;
+// uploads the images among assets [first, last), they stay in the texture cache until the sprites made from them take over
+void Game::upload_images(size_t first, size_t last) {
+	for (size_t i = first; i < last; i++) {
+		Asset& asset = assets.get(i);
+		if (asset.kind == AssetKind::IMAGE && asset.surface != nullptr) {
+			preloaded.push_back(textures.upload(game_renderer, asset.path, asset.surface));
+			asset.surface = nullptr;
 		}
+	}
+}
+
+// for whatever can't go on without every asset, usually they're all in long before
+void Game::finish_loading() {
+	if (all_assets_ready || game_renderer == NULL)
+		return;
+	assets.wait_for_all();
+	receive_assets();
+}
 
-		SDL_Rect new_rect = rect;
-		rect = node.node_sprite.rect;
-		node.node_sprite.rect = new_rect;
-		index++;
+// everything the player should see or hear because of what just happened in the engine
+void Game::handle_engine_events(unsigned int events) {
+	if (events & ENGINE_ATE_FOOD) { // stuff that happens when snek eats food
+		if (!attract_mode)
+			play_if_sound_on(collect_sfx);
+	}
+
+	if (events & ENGINE_DIED) {
+		if (attract_mode)
+			start_attract(); // the demo just starts over
+		else if (!replaying) { // a replay goes on to its next game by itself
+			recorder.end_game(engine.tick_count, engine.score);
+			game_state = GameState::GAME_END;
+			end_screen();
+		}
 	}
-	check_food_eat();
 }
 
-int Game::generate_random_number(int range_begin, int range_end, int multiples = 1) {
-	std::random_device rand;
-	std::mt19937 gen(rand());
-	std::uniform_int_distribution<> dis(range_begin, range_end);
-	return dis(gen) * multiples;
+// where a cell ends up on screen with the current camera
+SDL_Rect Game::cell_rect(const BoardSnapshot& board, Cell cell) {
+	return camera.to_screen(board.cell_x(cell) * tile_size, board.cell_y(cell) * tile_size, tile_size, tile_size);
 }
 
-void Game::create_new_snek_node() {
-	SnekNode last_in_vec = snek_nodes.back();
-	int startx = last_in_vec.node_sprite.rect.x;
-	int starty = last_in_vec.node_sprite.rect.y;
+// how far the snek is from its last cells (0) to its current ones (1), with the time since the last move measured to
+// a fraction of a tick. a move only slides for max_slide_ms, so the snek isn't drawn a whole slow move behind
+double Game::slide_fraction(const BoardSnapshot& board) {
+	if (!smooth || board.moves == 0)
+		return 1.0;
 
+	Uint32 slide_ms = board.snek_move_interval < max_slide_ms ? board.snek_move_interval : max_slide_ms;
+	double elapsed = (double)(board.time - board.snek_move_timer) + tick_fraction * tick_interval;
+	return elapsed >= slide_ms ? 1.0 : elapsed / slide_ms;
+}
 
-	if (snek_nodes.size() >= 2) {
-		SnekNode one_before_last = snek_nodes[snek_nodes.size() - 2];
+// a tile sized sprite at a board pixel position that can hang over the board's edges. whatever hangs over shows up
+// on the other side, the same way the snek goes through the edges
+void Game::add_wrapped(const SDL_Rect& region, int board_x, int board_y) {
+	const int board_pixel_width = board_width * tile_size, board_pixel_height = board_height * tile_size;
 
-		if (one_before_last.node_sprite.rect.x + 50 == last_in_vec.node_sprite.rect.x)
-			startx += 50;
-		else if (one_before_last.node_sprite.rect.x - 50 == last_in_vec.node_sprite.rect.x)
-			startx -= 50;
-		else if (one_before_last.node_sprite.rect.y - 50 == last_in_vec.node_sprite.rect.y)
-			starty -= 50;
-		else if (one_before_last.node_sprite.rect.y + 50 == last_in_vec.node_sprite.rect.y)
-			starty += 50;
-	}
-	else {
-		switch (current_direction) {
-			case NodeDirection::UP:
-				starty += 50;
-				break;
-			case NodeDirection::DOWN:
-				starty -= 50;
-				break;
-			case NodeDirection::LEFT:
-				startx += 50;
-				break;
-			case NodeDirection::RIGHT:
-				startx -= 50;
-				break;
+	for (int shift_y = -board_pixel_height; shift_y <= board_pixel_height; shift_y += board_pixel_height) {
+		for (int shift_x = -board_pixel_width; shift_x <= board_pixel_width; shift_x += board_pixel_width) {
+			int x = board_x + shift_x, y = board_y + shift_y;
+			int left = x > 0 ? x : 0, top = y > 0 ? y : 0;
+			int right = x + tile_size < board_pixel_width ? x + tile_size : board_pixel_width;
+			int bottom = y + tile_size < board_pixel_height ? y + tile_size : board_pixel_height;
+			if (left >= right || top >= bottom)
+				continue;
+
+			SDL_Rect src = { region.x + (left - x) * region.w / tile_size, region.y + (top - y) * region.h / tile_size,
+				(right - left) * region.w / tile_size, (bottom - top) * region.h / tile_size };
+			board_batch.add(board_atlas, src, camera.to_screen(left, top, right - left, bottom - top));
 		}
 	}
-
-	SnekNode node = { "sprites/snek_tail.png", game_renderer, textures, startx, starty };
-	snek_nodes.emplace_back(node);
 }
 
-void Game::spawn_food() {
-	// move food until a free place has been found - todo - surely there's a more efficient way to do this?
-	while (true) {
-		bool was_found = false;
+// the grid, the snek and the food as one draw call. only the tiles the camera can see are looked at,
+// so a frame costs the same on a 20x15 board as on a 4096x4096 one, however long the snek is.
+// while the snek slides between cells the body stays where it is, only the two ends move: the head slides in from the
+// cell it left and the tail slides out of the cell it left. every segment would slide onto the one in front of it, so
+// that looks just the same as moving each of them
+void Game::draw_board(const BoardSnapshot& board) {
+	Cell head = board.head;
+	double fraction = slide_fraction(board);
+	sliding = fraction < 1.0;
 
-		int x = generate_random_number(0, (SCREEN_WIDTH / tile_size) - 1, tile_size); // 20x15 grid
-		int y = generate_random_number(0, (SCREEN_HEIGHT / tile_size) - 1, tile_size);
+	int step_x = 0, step_y = 0;
+	switch (board.current_direction) {
+		case NodeDirection::UP: step_y = -1; break;
+		case NodeDirection::DOWN: step_y = 1; break;
+		case NodeDirection::LEFT: step_x = -1; break;
+		case NodeDirection::RIGHT: step_x = 1; break;
+		default: break;
+	}
+	int behind = (int)((1.0 - fraction) * tile_size);
+	int head_x = board.cell_x(head) * tile_size - step_x * behind;
+	int head_y = board.cell_y(head) * tile_size - step_y * behind;
+	camera.follow(head_x + tile_size / 2, head_y + tile_size / 2);
 
-		food.rect.x = x;
-		food.rect.y = y;
+	int first_x, first_y, last_x, last_y;
+	camera.visible_tiles(tile_size, board_width, board_height, first_x, first_y, last_x, last_y);
 
-		for (auto&& node : snek_nodes) {
-			if (SDL_HasIntersection(&food.rect, &node.node_sprite.rect)) {
-				was_found = true;
-				break;
-			}
+	board_batch.begin();
+
+	// the background, one grid.png per chunk the screen overlaps, cut short at the right and bottom board edges
+	const SDL_Rect& grid_region = board_atlas.region(ATLAS_GRID);
+	for (int chunk_y = first_y - first_y % grid_chunk_height; chunk_y < last_y; chunk_y += grid_chunk_height) {
+		for (int chunk_x = first_x - first_x % grid_chunk_width; chunk_x < last_x; chunk_x += grid_chunk_width) {
+			int tiles_x = board_width - chunk_x < grid_chunk_width ? board_width - chunk_x : grid_chunk_width;
+			int tiles_y = board_height - chunk_y < grid_chunk_height ? board_height - chunk_y : grid_chunk_height;
+
+			SDL_Rect src = { grid_region.x, grid_region.y, grid_region.w * tiles_x / grid_chunk_width, grid_region.h * tiles_y / grid_chunk_height };
+			board_batch.add(board_atlas, src, camera.to_screen(chunk_x * tile_size, chunk_y * tile_size, tiles_x * tile_size, tiles_y * tile_size));
 		}
+	}
 
-		if (was_found)
-			continue;
-		else
-			break;
+	int food_x = board.cell_x(board.food_cell), food_y = board.cell_y(board.food_cell);
+	if (food_x >= first_x && food_x < last_x && food_y >= first_y && food_y < last_y)
+		board_batch.add(board_atlas, board_atlas.region(ATLAS_FOOD + board.food_variant), cell_rect(board, board.food_cell));
+
+	// the snek is found through the occupancy bits of the visible rows instead of walking every segment
+	const SDL_Rect& head_region = board_atlas.region(ATLAS_SNEK_HEAD);
+	const SDL_Rect& tail_region = board_atlas.region(ATLAS_SNEK_TAIL);
+	for (int y = first_y; y < last_y; y++) {
+		board.occupancy.for_each_set(board.make_cell(first_x, y), board.make_cell(last_x - 1, y) + 1, [&](Cell cell) {
+			if (cell != head)
+				board_batch.add(board_atlas, tail_region, cell_rect(board, cell));
+		});
 	}
-	food.swap_textures(food_sprites[generate_random_number(0, 3)], game_renderer, textures);
-}
 
-void Game::end_screen() {
-	SDL_DestroyTexture(end_score_text.texture);
-	end_score_text.texture = nullptr;
+	if (sliding) {
+		// the cell the tail left, if it left one next to it (across an edge counts)
+		Cell tail = board.tail;
+		int tail_step_x = board.cell_x(tail) - board.cell_x(board.last_tail);
+		int tail_step_y = board.cell_y(tail) - board.cell_y(board.last_tail);
+		tail_step_x = tail_step_x > 1 ? -1 : (tail_step_x < -1 ? 1 : tail_step_x);
+		tail_step_y = tail_step_y > 1 ? -1 : (tail_step_y < -1 ? 1 : tail_step_y);
 
-	if (Mix_PlayingMusic() == 1)
-		Mix_HaltMusic();
+		if (abs(tail_step_x) + abs(tail_step_y) == 1)
+			add_wrapped(tail_region, board.cell_x(tail) * tile_size - tail_step_x * behind, board.cell_y(tail) * tile_size - tail_step_y * behind);
+	}
+	add_wrapped(head_region, head_x, head_y);
 
-	play_if_sound_on(end_sfx);
+	board_batch.submit(game_renderer, board_atlas);
+}
 
-	end_score_text_stream << "Your score: " << score;
-	end_score_text = { end_score_text_stream.str(), game_renderer, textures, 200, 400 };
-	end_score_text_stream.str(std::string());
+void Game::end_screen() {
+	halt_music();
+	play_if_sound_on(end_sfx);
 }
 
 void Game::handle_events() {
+	SNEK_PROFILE_ZONE("Game::handle_events");
 	SDL_Event event;
 
-	if (SDL_PollEvent(&event) != 0) { // if the event poll is not empty
+	while (game_state != GameState::GAME_QUIT && SDL_PollEvent(&event) != 0) { // take every event that's waiting, not just one per frame
+		if (event.type != SDL_MOUSEMOTION)
+			redraw.invalidate(); // input can change anything on screen, and window events may need the frame again
+
+		if (event.type == SDL_KEYDOWN && measure_latency)
+			latency.key_down(event.key.timestamp);
+
 		if (event.type == SDL_QUIT)
 			quit();
-		else if (event.type == SDL_KEYDOWN) {
-			SDL_Keycode pressed_key = event.key.keysym.sym;
-			process_input(pressed_key);
+		else if (event.type == SDL_KEYDOWN)
+			apply_input({ InputCommand::KEY, event.key.keysym.sym });
+		else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+			if (game_state == GameState::GAME_MENU && clicked_github(event.button.x, event.button.y))
+				open_github();
+			apply_input({ InputCommand::CLICK, 0, event.button.x, event.button.y });
 		}
 	}
+}
 
-	if (game_state == GameState::GAME_MENU) { // main menu buttons
-		if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
-			SDL_Rect mouse_rect;
-			mouse_rect.w = mouse_rect.h = 1;
-			SDL_GetMouseState(&mouse_rect.x, &mouse_rect.y);
+// a key or click, on the simulation's side of things
+void Game::apply_input(const InputCommand& input) {
+	last_input_time = sim_time;
+	redraw.invalidate();
+	if (attract_mode) {
+		stop_attract(); // any key or click ends the demo and does nothing else
+		return;
+	}
 
-			if (SDL_HasIntersection(&mouse_rect, &sound_on_sprite.rect) && sound_on) {
-				sound_on = false;
-				if (Mix_PlayingMusic() == 1)
-					Mix_HaltMusic();
-			}
-			else if (SDL_HasIntersection(&mouse_rect, &sound_off_sprite.rect) && !sound_on) {
-				sound_on = true;
-				if (Mix_PlayingMusic() == 0)
-					Mix_PlayMusic(menu_music, -1);
-			}
-			else if (SDL_HasIntersection(&mouse_rect, &github_logo_sprite.rect)) {
-				#ifdef __WIN32__
-				system("start https://github.com/emredesu/snek");
-				#elif __APPLE__ || __MACH__
-				system("open https://github.com/emredesu/snek");
-				#elif __linux__
-				system("xdg-open https://github.com/emredesu/snek");
-				#endif
-			}
-		}
+	if (input.type == InputCommand::KEY)
+		process_input(input.key);
+	else
+		click(input.x, input.y);
+}
+
+// the main menu's sound buttons
+void Game::click(int x, int y) {
+	if (game_state != GameState::GAME_MENU)
+		return;
+
+	SDL_Rect mouse_rect = { x, y, 1, 1 };
+	if (SDL_HasIntersection(&mouse_rect, &sound_on_sprite.rect) && sound_on) {
+		sound_on = false;
+		halt_music();
 	}
-	else if (game_state == GameState::GAME_ACTIVE) {
-		if (snek_move_timer + snek_move_interval < SDL_GetTicks()) { // automatic snek movement
-			snek_move_timer = SDL_GetTicks();
-			move_snek();
-		}
-	
-		// teleport snek to the other side if it's out of bounds
-		if (snek_nodes[0].node_sprite.rect.x >= SCREEN_WIDTH) {
-			snek_nodes[0].node_sprite.rect.x = 0;
-			check_food_eat();
-		}
-		if (snek_nodes[0].node_sprite.rect.x < 0) {
-			snek_nodes[0].node_sprite.rect.x = SCREEN_WIDTH - tile_size;
-			check_food_eat();
-		}
-		if (snek_nodes[0].node_sprite.rect.y < 0) {
-			snek_nodes[0].node_sprite.rect.y = SCREEN_HEIGHT - tile_size;
-			check_food_eat();
-		}
-		if (snek_nodes[0].node_sprite.rect.y >= SCREEN_HEIGHT) {
-			snek_nodes[0].node_sprite.rect.y = 0;
-			check_food_eat();
-		}
+	else if (SDL_HasIntersection(&mouse_rect, &sound_off_sprite.rect) && !sound_on) {
+		sound_on = true;
+		play_music(menu_music);
+	}
+}
 
-		bool first = true;
-		for (auto&& node : snek_nodes) { // snek self collusion
-			if (first) {
-				first = false;
-				continue;
-			}
+// the menu's github button opens a browser, which is left to the thread that takes the events since system() waits for it
+bool Game::clicked_github(int x, int y) {
+	SDL_Rect mouse_rect = { x, y, 1, 1 };
+	return SDL_HasIntersection(&mouse_rect, &github_logo_sprite.rect);
+}
 
-			if (SDL_HasIntersection(&snek_nodes[0].node_sprite.rect, &node.node_sprite.rect)) {
-				game_state = GameState::GAME_END;
-				end_screen();
-			}
+void Game::open_github() {
+	#ifdef __WIN32__
+	system("start https://github.com/emredesu/snek");
+	#elif __APPLE__ || __MACH__
+	system("open https://github.com/emredesu/snek");
+	#elif __linux__
+	system("xdg-open https://github.com/emredesu/snek");
+	#endif
+}
+
+// advances the simulation by exactly tick_interval ms, all game timers count simulation time instead of wall time
+void Game::tick() {
+	SNEK_PROFILE_ZONE("Game::tick");
+	sim_time += tick_interval;
+
+	if (game_state == GameState::GAME_MENU || attract_mode) {
+		if (sim_time - menu_text_flash_timer >= menu_text_flash_interval) { // blinking text
+			menu_text_flash_timer = sim_time;
+			render_menu_text = !render_menu_text;
+			redraw.invalidate();
 		}
-		
+	}
+
+	if (game_state == GameState::GAME_MENU) {
+		if (sim_time - last_input_time >= attract_delay)
+			start_attract();
+	}
+	else if (game_state == GameState::GAME_ACTIVE && replaying)
+		tick_replay();
+	else if (game_state == GameState::GAME_ACTIVE) {
+		if (autopilot_on || attract_mode)
+			steer_with_autopilot();
+
+		unsigned int events = engine.tick(); // automatic snek movement
+		if (!attract_mode)
+			rewind.record_tick(engine);
+		if (events != ENGINE_NONE)
+			redraw.invalidate();
+		handle_engine_events(events);
 	}
 	else if (game_state == GameState::GAME_END) { // text that changes colour
-		if (end_text_colour_change_interval + end_text_colour_change_timer < SDL_GetTicks()) {
+		if (sim_time - end_text_colour_change_timer >= end_text_colour_change_interval) {
 			change_colour = !change_colour;
+			redraw.invalidate();
+			end_text_colour_change_timer = sim_time;
+		}
+	}
+}
 
-			SDL_DestroyTexture(you_won_text.texture);
-			you_won_text.texture = nullptr;
+// right before the snek would move on its own the autopilot picks a direction and presses the key for it,
+// so it goes through exactly the same input handling as a player would
+void Game::steer_with_autopilot() {
+	if (game_state != GameState::GAME_ACTIVE || engine.time + tick_interval - engine.snek_move_timer < engine.snek_move_interval)
+		return;
 
-			if (change_colour)
-				you_won_text = { "YOU HECKIN WON!!!", game_renderer, textures, 250, 300, 40, {128, 0, 128} };
-			else
-				you_won_text = { "YOU HECKIN WON!!!", game_renderer, textures, 250, 300, 40 };
+	if (attract_mode && engine.occupancy.free_count() == 0) {
+		start_attract(); // the demo filled the board, start another one
+		return;
+	}
 
-			end_text_colour_change_timer = SDL_GetTicks();
-		}
+	switch (autopilot.decide(engine)) {
+		case NodeDirection::UP: process_input(SDLK_UP); break;
+		case NodeDirection::DOWN: process_input(SDLK_DOWN); break;
+		case NodeDirection::LEFT: process_input(SDLK_LEFT); break;
+		case NodeDirection::RIGHT: process_input(SDLK_RIGHT); break;
+		default: break;
+	}
+}
+
+// a quick game the autopilot plays behind the "press a snek" text, without sound, until someone touches a key
+void Game::start_attract() {
+	finish_loading();
+	attract_mode = true;
+	game_state = GameState::GAME_ACTIVE;
+
+	engine.reset(board_width, board_height, ((uint64_t)attract_rng.next() << 32) | attract_rng.next());
+	engine.snek_move_interval = SnekEngine::min_move_interval * 2; // faster than a real game starts
+	redraw.invalidate();
+}
+
+void Game::stop_attract() {
+	attract_mode = false;
+	game_state = GameState::GAME_MENU;
+	redraw.invalidate();
+}
+
+// a direction key during a game. the turn goes into the recording and the rewind buffer first, only turns that do something are worth keeping.
+// while a replay plays nobody else gets to steer
+void Game::turn_snek(NodeDirection dir) {
+	if (replaying)
+		return;
+
+	if (engine.alive && engine.can_turn(dir) && !attract_mode) { // the demo's turns go in neither the replay nor the rewind buffer
+		recorder.record_turn(engine.tick_count, dir);
+		rewind.record_turn(engine, dir);
+	}
+	handle_engine_events(engine.turn(dir));
+}
+
+// one tick of a replay: the turns recorded right before it, then the engine's own tick, and the next game once the recording of this one is over
+void Game::tick_replay() {
+	NodeDirection dir;
+	while (replay_player.next_turn(engine, dir))
+		handle_engine_events(engine.turn(dir));
+
+	if (!replay_player.done(engine)) {
+		unsigned int events = engine.tick();
+		if (events != ENGINE_NONE)
+			redraw.invalidate();
+		handle_engine_events(events);
+	}
+
+	if (replay_player.done(engine))
+		next_replay_game();
+}
+
+void Game::next_replay_game() {
+	if (!replay_player.matches(engine))
+		std::cerr << "game " << replay_game + 1 << " of the replay didn't end like it was recorded (tick " << engine.tick_count << ", score " << engine.score << ")" << std::endl;
+
+	if (replay_game + 1 < replay.games.size()) {
+		replay_game++;
+		initialize_game();
+	}
+	else {
+		replaying = false; // enter starts a normal game from here
+		game_state = GameState::GAME_END;
+		end_screen();
+	}
+	redraw.invalidate();
+}
+
+// jumps to a tick of the whole replay without drawing or playing anything: games that end before it are skipped
+// by their end records and the one it's in is simulated as fast as the engine goes
+void Game::seek_replay(uint64_t target) {
+	auto start = std::chrono::steady_clock::now();
+	uint64_t skipped = target;
+
+	while (replay_game + 1 < replay.games.size() && replay.games[replay_game].finished && replay.games[replay_game].end_tick <= target) {
+		target -= replay.games[replay_game].end_tick;
+		replay_game++;
+	}
+	initialize_game();
+	replay_player.fast_forward(engine, target);
+	redraw.invalidate();
+
+	if (skipped > 0) {
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double realtime = skipped * tick_interval / 1000.0;
+		std::clog << "skipped " << realtime << " s of replay in " << seconds * 1000 << " ms (" << (uint64_t)(realtime / (seconds > 0 ? seconds : 1e-9)) << "x realtime)" << std::endl;
+	}
+}
+
+// takes the game back to tick, or as far back as the rewind buffer goes, and it goes on from there. a finished game
+// comes back to life. the recording of the game stops where it was, a replay can't go back in time
+void Game::rewind_to(uint64_t tick) {
+	if (replaying || attract_mode || rewind.empty())
+		return;
+
+	recorder.end_game(engine.tick_count, engine.score);
+	if (!rewind.rewind(engine, tick > rewind.oldest_tick() ? tick : rewind.oldest_tick()))
+		return;
+
+	if (game_state == GameState::GAME_END) {
+		game_state = GameState::GAME_ACTIVE;
+		if (sound_on)
+			play_music(ingame_music);
 	}
+	redraw.invalidate();
+}
+
+// simulation ms until the next timer that changes what's on screen, -1 if nothing will change without input
+int Game::ms_until_next_change() {
+	int remaining = -1;
+
+	if (game_state == GameState::GAME_MENU)
+		remaining = (int)(menu_text_flash_timer + menu_text_flash_interval - sim_time); // sooner than the demo starting
+	else if (game_state == GameState::GAME_ACTIVE) {
+		remaining = (int)(engine.snek_move_timer + engine.snek_move_interval - engine.time);
+		if (replaying && replay_player.ticks_until_turn(engine) * tick_interval < (uint64_t)remaining)
+			remaining = (int)(replay_player.ticks_until_turn(engine) * tick_interval); // the replay turns sooner
+	}
+	else if (game_state == GameState::GAME_END)
+		remaining = (int)(end_text_colour_change_timer + end_text_colour_change_interval - sim_time);
+	else
+		return -1;
+
+	return remaining < 0 ? 0 : remaining; // overdue timers fire on the next tick
 }
 
 void Game::process_input(SDL_Keycode pressed_key) {
 	if (pressed_key == SDLK_ESCAPE)
 		quit();
 
-	if (game_state == GameState::GAME_MENU and pressed_key != SDLK_RETURN)
+#ifdef SNEK_PROFILER
+	if (pressed_key == SDLK_F3) {
+		show_profiler_hud = !show_profiler_hud;
+		return;
+	}
+	if (pressed_key == SDLK_F4) {
+		write_profiler_trace();
+		return;
+	}
+#endif
+
+	if (game_state == GameState::GAME_LOADING)
+		return; // nothing to press yet
+
+	if (game_state == GameState::GAME_MENU and pressed_key != SDLK_RETURN) {
+		finish_loading();
 		game_state = GameState::GAME_INSTRUCTIONS;
+	}
 
 	if (game_state == GameState::GAME_INSTRUCTIONS and pressed_key == SDLK_RETURN) {
 		initialize_game();
@@ -364,45 +765,35 @@ void Game::process_input(SDL_Keycode pressed_key) {
 			case SDLK_w:
 			case SDLK_UP:
 				// snake head up
-				if (!(current_direction == NodeDirection::UP || current_direction == NodeDirection::DOWN)) {
-					current_direction = NodeDirection::UP;
-					move_snek();
-					snek_move_timer = SDL_GetTicks();
-				}
+				turn_snek(NodeDirection::UP);
 				break;
 			case SDLK_d:
 			case SDLK_RIGHT:
 				// snake head right
-				if (!(current_direction == NodeDirection::LEFT || current_direction == NodeDirection::RIGHT)) {
-					current_direction = NodeDirection::RIGHT;
-					move_snek();
-					snek_move_timer = SDL_GetTicks();
-				}
+				turn_snek(NodeDirection::RIGHT);
 				break;
 			case SDLK_a:
 			case SDLK_LEFT:
 				// snake head left
-				if (!(current_direction == NodeDirection::LEFT || current_direction == NodeDirection::RIGHT)) {
-					current_direction = NodeDirection::LEFT;
-					move_snek();
-					snek_move_timer = SDL_GetTicks();
-				}
+				turn_snek(NodeDirection::LEFT);
 				break;
 			case SDLK_s:
 			case SDLK_DOWN:
 				// snake head down
-				if (!(current_direction == NodeDirection::UP || current_direction == NodeDirection::DOWN)) {
-					current_direction = NodeDirection::DOWN;
-					move_snek();
-					snek_move_timer = SDL_GetTicks();
-				}
+				turn_snek(NodeDirection::DOWN);
 				break;
 			case SDLK_m:
 				sound_on = !sound_on;
 				if (sound_on)
-					Mix_PlayMusic(ingame_music, -1);
+					play_music(ingame_music);
 				else
-					Mix_HaltMusic();
+					halt_music();
+				break;
+			case SDLK_BACKSPACE:
+				rewind_to(engine.tick_count > rewind_step_ticks ? engine.tick_count - rewind_step_ticks : 0);
+				break;
+			case SDLK_HOME:
+				rewind_to(rewind.oldest_tick());
 				break;
 		}		
 	}
@@ -411,59 +802,499 @@ void Game::process_input(SDL_Keycode pressed_key) {
 			game_state = GameState::GAME_ACTIVE;
 			initialize_game();
 		}
+		else if (pressed_key == SDLK_BACKSPACE)
+			rewind_to(engine.tick_count > rewind_step_ticks ? engine.tick_count - rewind_step_ticks : 0);
+		else if (pressed_key == SDLK_HOME)
+			rewind_to(rewind.oldest_tick());
 	}
 }
 
+// everything the frame needs from the simulation, see FrameState
+void Game::capture_frame(FrameState& frame) {
+	frame.game_state = game_state;
+	frame.render_menu_text = render_menu_text;
+	frame.sound_on = sound_on;
+	frame.attract_mode = attract_mode;
+	frame.change_colour = change_colour;
+	frame.score = engine.score;
+	frame.changes = redraw.change_count();
+	frame.keys_applied = keys_applied;
+	frame.board.capture(engine);
+}
+
+// without --threaded the frame is captured right before it's drawn
 void Game::update() {
+	capture_frame(current_frame);
+	draw_frame(current_frame);
+}
+
+// draws from the frame alone, with --threaded the simulation is busy with the next tick meanwhile
+void Game::draw_frame(const FrameState& frame) {
+	SNEK_PROFILE_ZONE("Game::draw_frame");
 	SDL_RenderClear(game_renderer); // clear screen - this always has to be on top of the update function
 
-	if (game_state == GameState::GAME_MENU) {
-		SDL_RenderCopy(game_renderer, menu_image.texture, 0, &menu_image.rect);
-		SDL_RenderCopy(game_renderer, github_logo_sprite.texture, 0, &github_logo_sprite.rect);
+	if (frame.game_state == GameState::GAME_LOADING) {
+		// a bar that fills up as the assets come in, out of plain rectangles since there's nothing else to draw with yet
+		SDL_Rect bar = { SCREEN_WIDTH / 4, SCREEN_HEIGHT / 2 - 10, SCREEN_WIDTH / 2, 20 };
+		SDL_SetRenderDrawColor(game_renderer, 220, 220, 220, 255);
+		SDL_RenderFillRect(game_renderer, &bar);
 
-		if (menu_text_flash_interval + menu_text_flash_timer < SDL_GetTicks()) { // blinking text
-			menu_text_flash_timer = SDL_GetTicks();
-			render_menu_text = !render_menu_text;
-		}
+		bar.w = (int)(bar.w * assets.loaded_count() / (assets.size() > 0 ? assets.size() : 1));
+		SDL_SetRenderDrawColor(game_renderer, 128, 0, 128, 255);
+		SDL_RenderFillRect(game_renderer, &bar);
+		SDL_SetRenderDrawColor(game_renderer, 255, 255, 255, 255);
+		SNEK_PROFILE_DRAW_CALLS(2);
+	}
+	else if (frame.game_state == GameState::GAME_MENU) {
+		SDL_RenderCopy(game_renderer, menu_image.texture.get(), 0, &menu_image.rect);
+		SNEK_PROFILE_DRAW_CALLS(1);
+		SDL_RenderCopy(game_renderer, github_logo_sprite.texture.get(), 0, &github_logo_sprite.rect);
+		SNEK_PROFILE_DRAW_CALLS(1);
 
-		if (render_menu_text)
-			SDL_RenderCopy(game_renderer, start_text.texture, 0, &start_text.rect);
+		if (frame.render_menu_text)
+			start_text.render(game_renderer);
 
-		if (sound_on)
-			SDL_RenderCopy(game_renderer, sound_on_sprite.texture, 0, &sound_on_sprite.rect);
-		else if (!sound_on)
-			SDL_RenderCopy(game_renderer, sound_off_sprite.texture, 0, &sound_off_sprite.rect);
+		if (frame.sound_on)
+			SDL_RenderCopy(game_renderer, sound_on_sprite.texture.get(), 0, &sound_on_sprite.rect);
+		else
+			SDL_RenderCopy(game_renderer, sound_off_sprite.texture.get(), 0, &sound_off_sprite.rect);
+		SNEK_PROFILE_DRAW_CALLS(1);
 	}
-	else if (game_state == GameState::GAME_ACTIVE) {
-		SDL_RenderCopy(game_renderer, grid.texture, 0, &grid.rect);
-		SDL_RenderCopy(game_renderer, score_text.texture, 0, &score_text.rect);
-		SDL_RenderCopy(game_renderer, food.texture, 0, &food.rect);
+	else if (frame.game_state == GameState::GAME_ACTIVE) {
+		if (frame.score != shown_score) {
+			snprintf(score_text_buffer, sizeof(score_text_buffer), "Score: %u", frame.score);
+			score_text.set_text(score_text_buffer);
+			shown_score = frame.score;
+		}
+
+		draw_board(frame.board);
+		score_text.render(game_renderer);
 
-		for (auto&& node : snek_nodes)
-			SDL_RenderCopy(game_renderer, node.node_sprite.texture, 0, &node.node_sprite.rect);
+		if (frame.attract_mode && frame.render_menu_text)
+			start_text.render(game_renderer);
 	}
-	else if (game_state == GameState::GAME_INSTRUCTIONS)
-		SDL_RenderCopy(game_renderer, instructions_image.texture, 0, &instructions_image.rect);
-	else if (game_state == GameState::GAME_END) {
-		SDL_RenderCopy(game_renderer, congratulations_image.texture, 0, &congratulations_image.rect);
-		SDL_RenderCopy(game_renderer, you_won_text.texture, 0, &you_won_text.rect);
-		SDL_RenderCopy(game_renderer, end_score_text.texture, 0, &end_score_text.rect);
-		SDL_RenderCopy(game_renderer, restart_game_text.texture, 0, &restart_game_text.rect);
-		SDL_RenderCopy(game_renderer, exit_game_text.texture, 0, &exit_game_text.rect);
+	else if (frame.game_state == GameState::GAME_INSTRUCTIONS) {
+		SDL_RenderCopy(game_renderer, instructions_image.texture.get(), 0, &instructions_image.rect);
+		SNEK_PROFILE_DRAW_CALLS(1);
+	}
+	else if (frame.game_state == GameState::GAME_END) {
+		if (frame.score != shown_end_score) {
+			snprintf(end_score_text_buffer, sizeof(end_score_text_buffer), "Your score: %u", frame.score);
+			end_score_text.set_text(end_score_text_buffer);
+			shown_end_score = frame.score;
+		}
+		you_won_text.colour = frame.change_colour ? SDL_Colour { 128, 0, 128, 255 } : SDL_Colour { 0, 0, 0, 255 }; // text that changes colour
+
+		SDL_RenderCopy(game_renderer, congratulations_image.texture.get(), 0, &congratulations_image.rect);
+		SNEK_PROFILE_DRAW_CALLS(1);
+		you_won_text.render(game_renderer);
+		end_score_text.render(game_renderer);
+		restart_game_text.render(game_renderer);
+		exit_game_text.render(game_renderer);
 	}
+
+#ifdef SNEK_PROFILER
+	if (show_profiler_hud)
+		draw_profiler_hud();
+#endif
 }
 
-void Game::render() {
+void Game::render(uint64_t keys_shown) {
+	SNEK_PROFILE_ZONE("Game::render");
 	SDL_RenderPresent(game_renderer);
+	last_present_counter = SDL_GetPerformanceCounter();
+	pacer.presented();
+	if (measure_latency)
+		latency.presented(keys_shown);
+
+	if (!first_frame_shown) {
+		first_frame_shown = true;
+		std::clog << "first frame after " << (SDL_GetPerformanceCounter() - startup_counter) * 1000 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+	}
+
+#ifdef SNEK_PROFILER
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (last_present != 0)
+		hud_frame_ms = (double)(now - last_present) * 1000.0 / SDL_GetPerformanceFrequency();
+	last_present = now;
+	hud_draw_calls = Profiler::instance().draw_calls.exchange(0);
+#endif
+}
+
+#ifdef SNEK_PROFILER
+// frame time, tick time, draw calls and textures in the top left corner, F3 turns it on and off
+void Game::draw_profiler_hud() {
+	snprintf(hud_buffer, sizeof(hud_buffer), "frame %.2f ms", hud_frame_ms);
+	hud_text[0].set_text(hud_buffer);
+	snprintf(hud_buffer, sizeof(hud_buffer), "tick %.2f us", hud_tick_us);
+	hud_text[1].set_text(hud_buffer);
+	snprintf(hud_buffer, sizeof(hud_buffer), "draw calls %llu", (unsigned long long)hud_draw_calls);
+	hud_text[2].set_text(hud_buffer);
+	snprintf(hud_buffer, sizeof(hud_buffer), "textures %u (%u KB)", (unsigned int)textures.texture_count(), (unsigned int)(textures.texture_bytes() / 1024));
+	hud_text[3].set_text(hud_buffer);
+
+	for (Text& line : hud_text)
+		line.render(game_renderer);
+}
+
+void Game::write_profiler_trace() {
+	if (Profiler::instance().write_chrome_trace(trace_path))
+		std::clog << "wrote profiler trace to \"" << trace_path << "\"" << std::endl;
+	else
+		std::cerr << "couldn't write profiler trace to \"" << trace_path << "\"" << std::endl;
+}
+#endif
+
+// with vsync a frame drawn right after a vblank waits a whole refresh before it's shown, and any key pressed in the
+// meantime waits for the frame after that. so instead of drawing straight away this sleeps until just enough before the
+// next vblank to draw one frame and returns true, the loop then takes the input and ticks that came in while it slept.
+// the vblanks are guessed from when the last present returned, which is right after one with vsync
+bool Game::wait_for_late_input() {
+	if (!late_input || !vsync || pacer.target_fps > 0 || last_present_counter == 0 || redraw.refresh_rate <= 0)
+		return false;
+
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 frame = frequency / redraw.refresh_rate;
+	const Uint64 margin = frequency / 500; // 2 ms for the present itself and for sleeping a bit too long
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 next_vblank = last_present_counter + frame;
+	if (now >= next_vblank)
+		next_vblank += (now - next_vblank) / frame * frame + frame; // frames were skipped since, find the coming one
+
+	Uint64 needed = draw_estimate + margin;
+	if (next_vblank - now <= needed)
+		return false; // no time to spare, draw now
+	Uint32 sleep_ms = (Uint32)((next_vblank - now - needed) * 1000 / frequency);
+	if (sleep_ms == 0)
+		return false;
+
+	SDL_Delay(sleep_ms);
+	return true;
+}
+
+// the main loop: every iteration takes all pending input, catches the simulation up to the wall clock in fixed steps and draws one frame.
+// the simulation doesn't care how fast the display refreshes, it gets the same number of ticks per second either way
+void Game::run() {
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 tick_length = (Uint64)(frequency * tick_interval / 1000 / replay_speed) > 0 ? (Uint64)(frequency * tick_interval / 1000 / replay_speed) : 1;
+	const Uint64 max_catch_up = frequency / 4; // don't try to replay more than a quarter second after a stall
+	const int max_idle_wait = 200; // ms, short enough that the accumulator is never clamped just because we slept
+
+	Uint64 previous = SDL_GetPerformanceCounter();
+	Uint64 accumulator = 0;
+
+	redraw.start();
+	pacer.start();
+	if (measure_latency)
+		latency.start();
+
+	while (game_state != GameState::GAME_QUIT) {
+		Uint64 now = SDL_GetPerformanceCounter();
+		accumulator += now - previous;
+		previous = now;
+
+		if (accumulator > max_catch_up)
+			accumulator = max_catch_up;
+
+		handle_events();
+		if (!all_assets_ready)
+			receive_assets();
+
+		if (threaded && all_assets_ready && game_state != GameState::GAME_QUIT) {
+			run_threaded(); // everything from here on, the loading needed this thread for the uploads
+			break;
+		}
+
+#ifdef SNEK_PROFILER
+		Uint64 ticks_started = SDL_GetPerformanceCounter();
+		unsigned int ticks_run = 0;
+#endif
+
+		while (accumulator >= tick_length && game_state != GameState::GAME_QUIT) {
+			tick();
+			accumulator -= tick_length;
+#ifdef SNEK_PROFILER
+			ticks_run++;
+#endif
+		}
+
+#ifdef SNEK_PROFILER
+		if (ticks_run > 0)
+			hud_tick_us = (double)(SDL_GetPerformanceCounter() - ticks_started) * 1e6 / frequency / ticks_run;
+		if (show_profiler_hud)
+			redraw.invalidate(); // the numbers change every frame
+#endif
+
+		if (game_state == GameState::GAME_QUIT)
+			break;
+
+		if (redraw.should_draw()) {
+			if (wait_for_late_input())
+				continue; // round again for the input that came in meanwhile, then draw
+
+			pacer.wait();
+			now = SDL_GetPerformanceCounter();
+			accumulator += now - previous; // the snek is drawn where it is at the moment the frame goes out
+			previous = now;
+			tick_fraction = accumulator < tick_length ? (double)accumulator / tick_length : 1.0;
+
+			Uint64 draw_started = SDL_GetPerformanceCounter();
+			update();
+			draw_estimate = (draw_estimate * 7 + (SDL_GetPerformanceCounter() - draw_started)) / 8;
+			render();
+			redraw.presented();
+			if (sliding && game_state == GameState::GAME_ACTIVE)
+				redraw.invalidate(); // keep drawing until the snek is all the way in its cells
+		}
+		else {
+			// nothing to draw, so sleep until the next input or until the next timer is due
+			int timeout = ms_until_next_change();
+			if (timeout > 0 && replay_speed != 1.0)
+				timeout = (int)(timeout / replay_speed); // simulation ms go by faster or slower than wall clock ms
+			if (timeout < 0 || timeout > max_idle_wait)
+				timeout = max_idle_wait;
+			else
+				timeout -= (int)(accumulator * 1000 / frequency); // part of the wait has already gone by
+
+			redraw.wait(timeout < 1 ? 1 : timeout);
+		}
+	}
+
+	redraw.report(std::clog);
+	if (pacer.target_fps > 0 || smooth)
+		pacer.report(std::clog);
+	if (measure_latency)
+		latency.report(std::clog);
+	if (threaded)
+		report_tick_lateness(std::clog);
+
+#ifdef SNEK_PROFILER
+	if (trace_path != nullptr && trace_on_exit)
+		write_profiler_trace();
+#endif
+
+	shutdown();
 }
 
-int main(int argc, char *args[]) {
-	Game game;
+// --threaded, once every asset is in: the simulation moves to a thread of its own (see simulate()) and this one only
+// takes the events and draws the newest frame the simulation published. a frame that's slow to draw or present means
+// the next one shows a later tick, the ticks themselves stay on time
+void Game::run_threaded() {
+	const int max_idle_wait = 200; // ms, the simulation wakes this thread up when there's something new to draw
+	const double tick_seconds = tick_interval / 1000.0 / replay_speed;
+
+	capture_frame(frames.write_slot()); // something to draw before the first tick
+	frames.write_slot().tick_due = std::chrono::steady_clock::now();
+	frames.publish();
+	frames.update();
+	uint64_t drawn_changes = frames.read().changes - 1; // so the first frame is drawn
+	uint64_t drawn_keys = frames.read().keys_applied;
 
-	while (game.game_state != GameState::GAME_QUIT) {
-		game.update();
-		game.render();
-		game.handle_events();
+	audio.start();
+	sim_running = true;
+	std::thread simulation(&Game::simulate, this);
+
+	bool quitting = false;
+	while (!quitting) {
+		forward_events(quitting);
+		frames.update();
+		if (frames.read().game_state == GameState::GAME_QUIT)
+			break;
+
+#ifdef SNEK_PROFILER
+		hud_tick_us = frames.read().tick_us;
+		if (show_profiler_hud)
+			redraw.invalidate(); // the numbers change every frame
+#endif
+
+		bool animating = sliding && frames.read().game_state == GameState::GAME_ACTIVE; // keep drawing until the snek is all the way in its cells
+		bool new_keys = frames.read().keys_applied != drawn_keys; // a key is drawn after it's handled, even if nothing changed
+		if (frames.read().changes != drawn_changes || new_keys || redraw.should_draw() || animating) {
+			pacer.wait();
+			frames.update(); // a tick might have finished while waiting, read() is another slot after this
+
+			const FrameState& frame = frames.read();
+			double since_tick = std::chrono::duration<double>(std::chrono::steady_clock::now() - frame.tick_due).count();
+			tick_fraction = since_tick <= 0.0 ? 0.0 : (since_tick < tick_seconds ? since_tick / tick_seconds : 1.0);
+
+			Uint64 draw_started = SDL_GetPerformanceCounter();
+			draw_frame(frame);
+			draw_estimate = (draw_estimate * 7 + (SDL_GetPerformanceCounter() - draw_started)) / 8;
+			render(frame.keys_applied);
+			redraw.presented();
+			drawn_changes = frame.changes;
+			drawn_keys = frame.keys_applied;
+		}
+		else
+			redraw.wait(max_idle_wait);
+	}
+
+	sim_running = false;
+	{
+		std::lock_guard<std::mutex> lock(sim_mutex);
 	}
-	return 0;
+	sim_wake.notify_one();
+	simulation.join();
+	audio.stop();
+	game_state = GameState::GAME_QUIT;
+}
+
+// takes every waiting event on the render thread, keys and clicks go on to the simulation thread
+void Game::forward_events(bool& quitting) {
+	SNEK_PROFILE_ZONE("Game::forward_events");
+	SDL_Event event;
+	bool forwarded = false;
+
+	while (SDL_PollEvent(&event) != 0) {
+		if (event.type == SDL_USEREVENT)
+			continue; // just a wakeup
+		if (event.type != SDL_MOUSEMOTION)
+			redraw.invalidate(); // window events may need the frame again
+
+		if (event.type == SDL_QUIT)
+			quitting = true;
+		else if (event.type == SDL_KEYDOWN) {
+#ifdef SNEK_PROFILER
+			if (event.key.keysym.sym == SDLK_F3 || event.key.keysym.sym == SDLK_F4) { // the overlay belongs to this thread
+				if (measure_latency)
+					latency.key_down(event.key.timestamp, keys_forwarded); // numbered like the key before it so the pending ones stay in order
+				if (event.key.keysym.sym == SDLK_F3)
+					show_profiler_hud = !show_profiler_hud;
+				else
+					write_profiler_trace();
+				continue;
+			}
+#endif
+			// the latency meter waits for a frame that handled the key, not just the next one
+			InputCommand command = { InputCommand::KEY, event.key.keysym.sym };
+			command.sequence = keys_forwarded + 1;
+			if (inputs.push(command)) { // a full queue drops the key, 256 of them are waiting already
+				keys_forwarded++;
+				forwarded = true;
+				if (measure_latency)
+					latency.key_down(event.key.timestamp, command.sequence);
+			}
+		}
+		else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+			if (frames.read().game_state == GameState::GAME_MENU && clicked_github(event.button.x, event.button.y))
+				open_github();
+			forwarded |= inputs.push({ InputCommand::CLICK, 0, event.button.x, event.button.y });
+		}
+	}
+
+	if (forwarded) {
+		{
+			std::lock_guard<std::mutex> lock(sim_mutex);
+		}
+		sim_wake.notify_one(); // the input is handled right away instead of at the next tick
+	}
+}
+
+// the simulation thread: ticks on a fixed grid of steady clock times, takes the input the render thread sent in between
+// and publishes a frame whenever something happened. in between it sleeps until the next tick is due or input arrives.
+// how late each round of ticks started is kept, that's the jitter nothing on the render or audio side should add to
+void Game::simulate() {
+	using clock = std::chrono::steady_clock;
+	clock::duration tick_length = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(tick_interval / replay_speed));
+	if (tick_length.count() <= 0)
+		tick_length = clock::duration(1);
+	const clock::duration max_catch_up = std::chrono::milliseconds(250); // don't try to replay more than a quarter second after a stall
+
+	clock::time_point next_tick = clock::now() + tick_length;
+	clock::time_point last_tick = clock::now();
+#ifdef SNEK_PROFILER
+	double tick_us = 0.0;
+#endif
+
+	while (sim_running.load() && game_state != GameState::GAME_QUIT) {
+		bool changed = false;
+		InputCommand input;
+		while (game_state != GameState::GAME_QUIT && inputs.pop(input)) {
+			apply_input(input);
+			if (input.type == InputCommand::KEY)
+				keys_applied = input.sequence;
+			changed = true;
+		}
+
+		clock::time_point now = clock::now();
+		if (now >= next_tick) {
+			double late_ms = std::chrono::duration<double, std::milli>(now - next_tick).count();
+			int bucket = (int)(late_ms * 10.0);
+			tick_lateness[bucket < lateness_buckets ? bucket : lateness_buckets - 1]++;
+			lateness_sum += late_ms;
+			if (late_ms > lateness_max)
+				lateness_max = late_ms;
+			if (now - next_tick >= tick_length)
+				ticks_late++;
+
+			if (now - next_tick > max_catch_up)
+				next_tick = now - max_catch_up;
+		}
+
+#ifdef SNEK_PROFILER
+		clock::time_point ticks_started = clock::now();
+		unsigned int ticks_run = 0;
+#endif
+
+		while (now >= next_tick && game_state != GameState::GAME_QUIT) {
+			tick();
+			last_tick = next_tick;
+			next_tick += tick_length;
+			changed = true;
+#ifdef SNEK_PROFILER
+			ticks_run++;
+#endif
+		}
+
+#ifdef SNEK_PROFILER
+		if (ticks_run > 0)
+			tick_us = std::chrono::duration<double, std::micro>(clock::now() - ticks_started).count() / ticks_run;
+		frames.write_slot().tick_us = tick_us; // capture_frame() leaves it alone
+#endif
+
+		if (changed)
+			publish_frame(last_tick);
+
+		std::unique_lock<std::mutex> lock(sim_mutex);
+		sim_wake.wait_until(lock, next_tick, [&]() { return !sim_running.load() || !inputs.empty(); });
+	}
+
+	publish_frame(last_tick); // the render thread stops once it sees GAME_QUIT in here
+}
+
+// hands the render thread a frame and wakes it up if anything on screen changed since the last one
+void Game::publish_frame(std::chrono::steady_clock::time_point tick_due) {
+	FrameState& frame = frames.write_slot();
+	capture_frame(frame);
+	frame.tick_due = tick_due;
+	uint64_t changes = frame.changes;
+	uint64_t keys = frame.keys_applied;
+	frames.publish(); // the frame isn't ours anymore
+
+	if (changes != published_changes || keys != published_keys || game_state == GameState::GAME_QUIT) {
+		published_changes = changes;
+		published_keys = keys;
+		SDL_Event event = {};
+		event.type = SDL_USEREVENT;
+		SDL_PushEvent(&event);
+	}
+}
+
+void Game::report_tick_lateness(std::ostream& out) {
+	unsigned long long rounds = 0;
+	for (unsigned long long count : tick_lateness)
+		rounds += count;
+	if (rounds == 0) {
+		out << "simulation thread: no ticks" << std::endl;
+		return;
+	}
+
+	unsigned long long seen = 0;
+	int p99 = 0;
+	while (p99 < lateness_buckets - 1 && (seen += tick_lateness[p99]) < rounds - rounds / 100)
+		p99++;
+
+	out << "simulation thread: ticks started late by " << lateness_sum / rounds << " ms on average, p99 " << (p99 + 1) / 10.0
+		<< " ms, max " << lateness_max << " ms, " << ticks_late << " more than a tick late, " << audio.dropped << " sounds dropped" << std::endl;
 }
\ No newline at end of file
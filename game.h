@@ -1,14 +1,47 @@
 #pragma once
 #include <SDL.h>
+#include <SDL_mixer.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 #include <sstream>
 #include <memory>
 #include "sprite.h"
 #include "text.h"
 #include "snek.h"
+#include "rng.h"
+#include "options.h"
+#include "engine.h"
+#include "texture_cache.h"
+#include "font_cache.h"
+#include "sprite_atlas.h"
+#include "redraw_scheduler.h"
+#include "camera.h"
+#include "autopilot.h"
+#include "replay.h"
+#include "rewind.h"
+#include "asset_loader.h"
+#include "latency_meter.h"
+#include "frame_pacer.h"
+#include "board_snapshot.h"
+#include "triple_buffer.h"
+#include "spsc_queue.h"
+#include "audio_thread.h"
+#include "profiler.h"
+
+// the order the board sprites are packed into the atlas in
+enum AtlasSprite {
+	ATLAS_GRID,
+	ATLAS_SNEK_HEAD,
+	ATLAS_SNEK_TAIL,
+	ATLAS_FOOD // food1 to food4 follow this one
+};
 
 enum class GameState {
 	DUMMY_VALUE,
+	GAME_LOADING,
 	GAME_MENU,
 	GAME_INSTRUCTIONS,
 	GAME_ACTIVE,
@@ -16,20 +49,139 @@ enum class GameState {
 	GAME_QUIT
 };
 
+// everything the renderer needs from the simulation for one frame. the simulation fills one in after its ticks and
+// the renderer draws only from it, so with --threaded the two never touch the same state (see Game::capture_frame())
+struct FrameState {
+	GameState game_state = GameState::DUMMY_VALUE;
+	bool render_menu_text = true;
+	bool sound_on = true;
+	bool attract_mode = false;
+	bool change_colour = true;
+	unsigned int score = 0;
+	BoardSnapshot board;
+	uint64_t changes = 0; // RedrawScheduler::change_count() when it was captured
+	uint64_t keys_applied = 0; // InputCommand::sequence of the last key handled before it was captured
+	std::chrono::steady_clock::time_point tick_due; // when the last tick was due, for how far into the next one a frame is
+#ifdef SNEK_PROFILER
+	double tick_us = 0.0;
+#endif
+};
+
+// a key or click on its way from the render thread, which owns the window and its events, to the simulation thread
+struct InputCommand {
+	enum Type {
+		KEY,
+		CLICK
+	};
+
+	Type type = KEY;
+	SDL_Keycode key = 0;
+	int x = 0;
+	int y = 0;
+	uint64_t sequence = 0; // keys are numbered from 1 as they're sent, for the latency meter
+};
+
 class Game {
 	public:
 		const int tile_size = 50;
-		const int SCREEN_WIDTH = tile_size * 20; // 1000px width
+		int board_width = 20; // in tiles, set with --board
+		int board_height = 15;
+		const int SCREEN_WIDTH = tile_size * 20; // 1000px width, bigger boards scroll
 		const int SCREEN_HEIGHT = tile_size * 15; // 750px height
 		const char* window_title = "snek";
 		GameState game_state = GameState::DUMMY_VALUE;
 		SDL_Renderer* game_renderer = NULL;
 		SDL_Window* window = NULL;
 
-		std::vector<SDL_Texture*> textures;
+		AssetPack pack; // every asset in one mapped file, if there is one. before the caches so it outlives what they loaded from it
+		TextureCache textures; // every texture in the game is owned through handles from here
+		FontCache fonts { textures };
 
 		bool sound_on = true;
 
+		// images and audio load on worker threads, the menu's first (see receive_assets())
+		AssetLoader assets;
+		size_t menu_batch = 0;
+		size_t menu_image_asset = 0; // the menu's images are menu_image_asset up to menu_music_asset
+		size_t menu_music_asset = 0;
+		size_t instructions_image_asset = 0; // then the screens' images up to first_board_asset
+		size_t first_board_asset = 0; // board_sprites, in order
+		size_t collect_sfx_asset = 0;
+		size_t end_sfx_asset = 0;
+		size_t ingame_music_asset = 0;
+		std::vector<TextureHandle> preloaded; // uploaded textures waiting for their sprites
+		bool menu_assets_ready = false;
+		bool all_assets_ready = false;
+		Uint64 startup_counter = 0; // for the time to the first frame
+		bool first_frame_shown = false;
+
+		const Uint32 tick_interval = SnekEngine::tick_interval; // ms of simulation per tick, every game timer is a multiple of this
+		Uint32 sim_time = 0; // ms of simulation since startup
+		RedrawScheduler redraw; // only present when something on screen changed
+
+		// presentation and input latency
+		bool vsync = true;
+		bool late_input = false; // with vsync, take input and draw just before the vblank instead of right after the last one
+		bool measure_latency = false;
+		LatencyMeter latency;
+		Uint64 last_present_counter = 0; // when SDL_RenderPresent() last returned, about when the last vblank was with vsync
+		Uint64 draw_estimate = 0; // performance counter ticks update() usually takes
+		FramePacer pacer; // --fps, and frame time statistics
+
+		// --threaded: the simulation ticks on a thread of its own and publishes a FrameState after its ticks, this thread
+		// only takes input and draws the newest one, and sounds go to the audio thread. nothing a frame or a sound costs
+		// can make a tick late then
+		bool threaded = false;
+		FrameState current_frame; // what update() draws without --threaded
+		TripleBuffer<FrameState> frames;
+		SpscQueue<InputCommand, 256> inputs;
+		AudioThread audio;
+		std::atomic<bool> sim_running { false };
+		std::mutex sim_mutex; // only for sleeping on sim_wake
+		std::condition_variable sim_wake;
+		uint64_t published_changes = 0; // the change count the render thread was last woken up for
+		uint64_t published_keys = 0; // and the keys_applied
+		uint64_t keys_forwarded = 0; // render thread
+		uint64_t keys_applied = 0; // simulation thread
+
+		// how late the simulation thread started its ticks, in 0.1 ms buckets, the last one takes everything later
+		static const int lateness_buckets = 500;
+		unsigned long long tick_lateness[lateness_buckets] = {};
+		unsigned long long ticks_late = 0; // more than a whole tick late
+		double lateness_sum = 0.0;
+		double lateness_max = 0.0;
+
+		// the snek slides into its next cell over this long after a move, or the whole move interval if that's shorter
+		bool smooth = true;
+		const Uint32 max_slide_ms = 80;
+		double tick_fraction = 0.0; // how far the simulation is into the next tick, for drawing in between ticks
+		bool sliding = false; // the last frame showed the snek between cells, so the next one has to be drawn too
+
+		uint64_t seed = 0;
+		Pcg32 rng; // hands out a seed to every new game
+
+		// autopilot, for --autopilot and for the demo that plays on its own when the menu is left alone
+		Autopilot autopilot;
+		bool autopilot_on = false; // steers the player's games too
+		bool attract_mode = false; // showing the demo
+		Uint32 attract_delay = 10000; // ms of no input on the menu before the demo starts
+		Uint32 last_input_time = 0;
+		Pcg32 attract_rng; // seeds the demo games, so they don't change what the real games get from rng
+
+		// replays, every session is recorded unless --no-record and --replay plays one back instead of taking input
+		ReplayWriter recorder;
+		const char* record_path = nullptr;
+		ReplayReader replay;
+		ReplayPlayer replay_player;
+		bool replaying = false;
+		size_t replay_game = 0; // the game of the replay that's playing
+		double replay_speed = 1.0; // simulation ms per wall clock ms
+		uint64_t replay_seek = 0; // where the replay starts once everything is loaded
+
+		// the last part of a real game, backspace goes back a second at a time and home as far back as it goes
+		RewindBuffer rewind;
+		const uint64_t rewind_step_ticks = 1000 / SnekEngine::tick_interval;
+
 		// menu
 		Text start_text;
 		Uint32 menu_text_flash_interval = 500;
@@ -47,24 +199,22 @@ class Game {
 		Sprite instructions_image;
 
 		// in-game
-		NodeDirection current_direction = NodeDirection::UP;
-		std::vector<SnekNode> snek_nodes;
+		SnekEngine engine; // the actual rules, everything here just shows what it does
+
+		SpriteAtlas board_atlas; // grid, snek and food all live in one texture
+		SpriteBatch board_batch;
+		Camera camera; // follows the head around boards bigger than the window
+		int grid_chunk_width = 1; // tiles covered by one copy of grid.png, the background is tiled out of these
+		int grid_chunk_height = 1;
+		std::vector<const char*> board_sprites = { "sprites/grid.png", "sprites/snek_head.png", "sprites/snek_tail.png",
+			"sprites/food1.png", "sprites/food2.png", "sprites/food3.png", "sprites/food4.png" };
 
 		Text score_text;
-		std::ostringstream score_text_stream;
+		char score_text_buffer[32] = {};
+		unsigned int shown_score = 0; // what score_text says, it's only set again when the score changes
 
-		unsigned int foods_eaten = 0;
-		unsigned int score = 0;
 		short last_speed_increase = 0;
 
-		Sprite grid;
-
-		Sprite food;
-		std::vector<const char*> food_sprites = { "sprites/food1.png", "sprites/food2.png", "sprites/food3.png", "sprites/food4.png" };
-
-		Uint32 snek_move_interval = 1000;
-		Uint32 snek_move_timer = 0;
-
 		SDL_RendererFlip flip = (SDL_RendererFlip)(SDL_FLIP_NONE);
 
 		Mix_Music* ingame_music = nullptr;
@@ -77,7 +227,8 @@ class Game {
 		Text end_score_text;
 		Text restart_game_text;
 		Text exit_game_text;
-		std::ostringstream end_score_text_stream;
+		char end_score_text_buffer[32] = {};
+		unsigned int shown_end_score = 0;
 
 		Uint32 end_text_colour_change_interval = 400;
 		Uint32 end_text_colour_change_timer = 0;
@@ -85,18 +236,64 @@ class Game {
 
 		Mix_Chunk* end_sfx = nullptr;
 
-		Game();
+#ifdef SNEK_PROFILER
+		// profiler overlay
+		bool show_profiler_hud = false;
+		Text hud_text[4];
+		char hud_buffer[64] = {};
+		double hud_frame_ms = 0.0;
+		double hud_tick_us = 0.0;
+		uint64_t hud_draw_calls = 0;
+		Uint64 last_present = 0;
+		const char* trace_path = "snek_trace.json";
+		bool trace_on_exit = false;
+
+		void draw_profiler_hud();
+		void write_profiler_trace();
+#endif
+
+		Game(const GameOptions&);
 		void quit();
+		void shutdown();
+		size_t release_textures();
+		void receive_assets();
+		void upload_images(size_t, size_t);
+		void finish_loading();
 		void initialize_game();
-		void move_snek();
-		void spawn_food();
-		void create_new_snek_node();
-		void check_food_eat();
-		int generate_random_number(int, int, int);
+		void handle_engine_events(unsigned int);
+		SDL_Rect cell_rect(const BoardSnapshot&, Cell);
+		double slide_fraction(const BoardSnapshot&);
+		void add_wrapped(const SDL_Rect&, int, int);
+		void draw_board(const BoardSnapshot&);
 		void play_if_sound_on(Mix_Chunk*, int);
+		void play_music(Mix_Music*);
+		void halt_music();
 		void end_screen();
 		void handle_events();
+		void apply_input(const InputCommand&);
+		void click(int, int);
+		bool clicked_github(int, int);
+		void open_github();
+		void tick();
+		void steer_with_autopilot();
+		void start_attract();
+		void stop_attract();
+		void turn_snek(NodeDirection);
+		void tick_replay();
+		void next_replay_game();
+		void seek_replay(uint64_t);
+		void rewind_to(uint64_t);
+		int ms_until_next_change();
 		void process_input(SDL_Keycode);
+		bool wait_for_late_input();
+		void capture_frame(FrameState&);
 		void update();
-		void render();
+		void draw_frame(const FrameState&);
+		void render(uint64_t keys_shown = ~0ULL); // keys_shown: the drawn frame's FrameState::keys_applied, with --threaded
+		void run();
+		void run_threaded();
+		void forward_events(bool&);
+		void simulate();
+		void publish_frame(std::chrono::steady_clock::time_point);
+		void report_tick_lateness(std::ostream&);
 };
\ No newline at end of file
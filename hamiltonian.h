@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include "snek.h"
+
+// fills next[cell] with the direction to leave each cell in, so that following it from anywhere visits every cell
+// of the board exactly once and comes back around. a snek following it can never run into itself, whatever its length.
+// a cycle only exists if the width or the height is even, returns false otherwise
+
+inline bool build_hamiltonian_cycle(int width, int height, std::vector<NodeDirection>& next) {
+	bool transposed = false;
+	if (width % 2 != 0) {
+		if (height % 2 != 0 || width < 2)
+			return false;
+		transposed = true; // build it for the board turned on its side and map the directions back
+	}
+	if (width < 2 || height < 2)
+		return false;
+
+	int w = transposed ? height : width;
+	int h = transposed ? width : height;
+	next.assign((size_t)width * height, NodeDirection::DUMMY_VALUE);
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			// right along the top row, then down and up the columns from the right edge to x = 1, and back up column 0
+			NodeDirection dir;
+			if (y == 0)
+				dir = (x < w - 1) ? NodeDirection::RIGHT : NodeDirection::DOWN;
+			else if (x == 0)
+				dir = NodeDirection::UP;
+			else if ((w - 1 - x) % 2 == 0)
+				dir = (y < h - 1) ? NodeDirection::DOWN : NodeDirection::LEFT;
+			else
+				dir = (y > 1) ? NodeDirection::UP : NodeDirection::LEFT;
+
+			if (transposed) {
+				switch (dir) {
+					case NodeDirection::UP: dir = NodeDirection::LEFT; break;
+					case NodeDirection::DOWN: dir = NodeDirection::RIGHT; break;
+					case NodeDirection::LEFT: dir = NodeDirection::UP; break;
+					case NodeDirection::RIGHT: dir = NodeDirection::DOWN; break;
+					default: break;
+				}
+				next[(size_t)x * width + y] = dir;
+			}
+			else
+				next[(size_t)y * width + x] = dir;
+		}
+	}
+	return true;
+}
\ No newline at end of file
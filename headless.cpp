@@ -0,0 +1,307 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "engine.h"
+#include "autopilot.h"
+#include "replay.h"
+#include "batch_env.h"
+
+// runs the snek engine without a window, audio or textures: a simple bot plays game after game as fast as the cpu allows.
+// meant for ci machines with no display, soak tests and benchmarks, e.g. "snek_headless --ticks 100000000 --seed 42".
+// "--autopilot" plays with the searching autopilot instead of the greedy bot, "--budget <us>" sets its time per move.
+// "--record <file>" writes every game to a replay, "--replay <file>" plays one back as fast as possible and checks it
+// ends the way it was recorded. the 20x15 and 40x30 boards run on an engine compiled for their size (see board_layout.h),
+// "--generic" runs them on the one that takes any size, for comparing the two. "--batch-check <environments>" steps a
+// BatchEnv next to one engine per environment and checks they play the same games
+
+// plays every game of a replay with nothing but the engine, returns false if any of them went differently
+static bool play_replay(const char* path) {
+	ReplayReader replay;
+	if (!replay.open(path)) {
+		std::cerr << "couldn't read the replay \"" << path << "\"" << std::endl;
+		return false;
+	}
+
+	SnekEngine engine;
+	ReplayPlayer player;
+	uint64_t ticks = 0;
+	size_t mismatches = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t game = 0; game < replay.games.size(); game++) {
+		player.start(replay, game, engine);
+		player.fast_forward(engine, ~0ULL);
+		ticks += engine.tick_count;
+
+		if (!player.matches(engine)) {
+			std::cerr << "game " << game + 1 << " ended at tick " << engine.tick_count << " with score " << engine.score << ", recorded were tick "
+				<< replay.games[game].end_tick << " and score " << replay.games[game].score << std::endl;
+			mismatches++;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double realtime = ticks * SnekEngine::tick_interval / 1000.0;
+
+	std::cout << "replay: " << replay.board_width << "x" << replay.board_height << ", " << replay.games.size() << " games, " << replay.total_turns()
+		<< " turns in " << replay.size() << " bytes" << std::endl;
+	std::cout << "ticks: " << ticks << " in " << seconds << " s (" << (uint64_t)(realtime / (seconds > 0 ? seconds : 1e-9)) << "x realtime), "
+		<< mismatches << " games didn't match" << std::endl;
+	return mismatches == 0;
+}
+
+// shortest distance between two coordinates when the board wraps around
+static int wrapped_distance(int a, int b, int size) {
+	int d = abs(a - b);
+	return d < size - d ? d : size - d;
+}
+
+// picks the free neighbour cell that gets closest to the food, going straight unless turning is better
+template <class Engine>
+static NodeDirection choose_direction(const Engine& engine) {
+	const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+	int food_x = engine.cell_x(engine.food_cell);
+	int food_y = engine.cell_y(engine.food_cell);
+
+	NodeDirection best = engine.current_direction;
+	int best_score = -1;
+
+	for (NodeDirection dir : directions) {
+		if (dir != engine.current_direction && !engine.can_turn(dir))
+			continue;
+
+		Cell next = engine.neighbour_cell(engine.snek.head(), dir);
+		int distance = wrapped_distance(engine.cell_x(next), food_x, engine.board_width) + wrapped_distance(engine.cell_y(next), food_y, engine.board_height);
+		int score = (engine.occupancy.test(next) && next != engine.snek.tail() ? 0 : 1 << 20) - distance;
+
+		if (score > best_score || (score == best_score && dir == engine.current_direction)) {
+			best_score = score;
+			best = dir;
+		}
+	}
+	return best;
+}
+
+// run_games() is kept out of main(): inlined into it along with the lambda that picks the layout, the loop over the
+// ticks kept the engine in memory instead of registers and the fixed layout ran slower than the generic one
+#ifdef _MSC_VER
+#define SNEK_NOINLINE __declspec(noinline)
+#else
+#define SNEK_NOINLINE __attribute__((noinline))
+#endif
+
+struct RunStats {
+	uint64_t games = 1;
+	uint64_t moves = 0;
+	uint64_t foods = 0;
+	unsigned int best_score = 0;
+};
+
+// plays game after game for the given number of ticks, choose(engine) steers right before every move
+template <class Engine, class Choose>
+SNEK_NOINLINE static RunStats run_games(Engine& engine, int width, int height, uint64_t ticks, uint64_t seed, ReplayWriter& recorder, Choose&& choose) {
+	RunStats stats;
+	Pcg32 seeds(seed);
+	uint64_t game_seed = seeds.next();
+	engine.reset(width, height, game_seed);
+	recorder.begin_game(game_seed);
+
+	for (uint64_t t = 0; t < ticks; t++) {
+		unsigned int events = ENGINE_NONE;
+
+		// only think right before the snek would move on its own
+		if (engine.time + SnekEngine::tick_interval - engine.snek_move_timer >= engine.snek_move_interval) {
+			NodeDirection dir = choose(engine);
+			if (dir != engine.current_direction && engine.can_turn(dir)) {
+				recorder.record_turn(engine.tick_count, dir);
+				events |= engine.turn(dir);
+			}
+		}
+		if (engine.alive)
+			events |= engine.tick(); // a turn into itself already ended the game before this tick
+
+		if (events & ENGINE_MOVED) stats.moves++;
+		if (events & ENGINE_ATE_FOOD) stats.foods++;
+
+		if (!engine.alive) {
+			if (engine.score > stats.best_score)
+				stats.best_score = engine.score;
+			recorder.end_game(engine.tick_count, engine.score);
+			game_seed = seeds.next();
+			engine.reset(width, height, game_seed);
+			recorder.begin_game(game_seed);
+			stats.games++;
+		}
+	}
+
+	if (engine.score > stats.best_score)
+		stats.best_score = engine.score;
+	if (recorder.is_open())
+		recorder.close(engine.tick_count, engine.score);
+	return stats;
+}
+
+// steps a BatchEnv with the given number of environments for about ticks environment steps and plays every one of its
+// games on a SnekEngine too, seeded with episode_seed(), feeding both the same actions. the greedy bot picks them on the
+// engine, with a random one every few steps so games also end early. a game that differs in score, food or length is
+// reported once and that environment is checked again from its next game on, after ten of them it stops. returns
+// false if any game differed
+static bool check_batch(size_t env_count, int width, int height, uint64_t ticks, uint64_t seed) {
+	std::vector<uint8_t> observations(env_count * width * height);
+	BatchEnv batch;
+	if (!batch.reset(env_count, width, height, seed, observations.data())) {
+		std::cerr << "a BatchEnv can't have a " << width << "x" << height << " board" << std::endl;
+		return false;
+	}
+
+	std::vector<SnekEngine> engines(env_count);
+	for (size_t env = 0; env < env_count; env++)
+		engines[env].reset(width, height, batch.episode_seed(env, 0));
+
+	std::vector<uint8_t> actions(env_count);
+	std::vector<float> rewards(env_count);
+	std::vector<uint8_t> dones(env_count);
+	std::vector<uint8_t> differs(env_count); // the game going on in the environment already differed
+	Pcg32 random(seed);
+	uint64_t steps = env_count > 0 ? ticks / env_count : 0;
+	uint64_t games = 0;
+	size_t mismatches = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint64_t step = 0; step < steps && mismatches < 10; step++) {
+		for (size_t env = 0; env < env_count; env++)
+			actions[env] = (uint8_t)(random.bounded(8) == 0 ? random.bounded(5) : (uint32_t)choose_direction(engines[env]));
+		batch.step(actions.data(), rewards.data(), dones.data());
+
+		for (size_t env = 0; env < env_count && mismatches < 10; env++) {
+			SnekEngine& engine = engines[env];
+			bool done = dones[env] != 0;
+
+			if (!differs[env]) {
+				NodeDirection dir = (NodeDirection)actions[env];
+				if (dir != NodeDirection::DUMMY_VALUE && engine.can_turn(dir))
+					engine.turn(dir);
+				else {
+					while (!(engine.tick() & ENGINE_MOVED))
+						;
+				}
+
+				// a finished game was already replaced by the next one in the batch, its score is in final_score then
+				unsigned int score = done ? batch.final_score[env] : batch.score[env];
+				Cell food = (Cell)(engine.cell_y(engine.food_cell) * width + engine.cell_x(engine.food_cell));
+				if (done != !engine.alive || score != engine.score
+					|| (!done && (batch.foods_eaten[env] != engine.foods_eaten || batch.length[env] != engine.snek.size() || batch.food[env] != food))) {
+					std::cerr << "environment " << env << " differs at step " << step + 1 << " of game " << batch.episodes[env] - done << ": batch "
+						<< (done ? "ended" : "going") << " with score " << score << ", food " << batch.foods_eaten[env] << ", length " << batch.length[env]
+						<< ", engine " << (engine.alive ? "going" : "ended") << " with score " << engine.score << ", food " << engine.foods_eaten
+						<< ", length " << engine.snek.size() << std::endl;
+					differs[env] = 1;
+					mismatches++;
+				}
+			}
+
+			if (done) {
+				engine.reset(width, height, batch.episode_seed(env, batch.episodes[env] - 1));
+				differs[env] = 0;
+				games++;
+			}
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "batch check: " << env_count << " environments on " << width << "x" << height << ", seed: " << seed << std::endl;
+	std::cout << "steps: " << batch.steps_taken << " in " << seconds << " s, " << games << " games finished, " << mismatches
+		<< " games differed from the engine" << std::endl;
+	return mismatches == 0;
+}
+
+int main(int argc, char* argv[]) {
+	uint64_t ticks = 10000000;
+	uint64_t seed = 1;
+	int width = 20, height = 15;
+	bool use_autopilot = false;
+	bool generic = false;
+	Autopilot autopilot;
+	const char* record_path = nullptr;
+	const char* replay_path = nullptr;
+	size_t batch_envs = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+			ticks = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--autopilot") == 0)
+			use_autopilot = true;
+		else if (strcmp(argv[i], "--generic") == 0)
+			generic = true;
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_path = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			replay_path = argv[++i];
+		else if (strcmp(argv[i], "--batch-check") == 0 && i + 1 < argc)
+			batch_envs = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+			autopilot.budget_us = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 2 || height < 2) {
+				std::cerr << "--board expects WIDTHxHEIGHT, e.g. 20x15" << std::endl;
+				return 1;
+			}
+		}
+		else {
+			std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+			return 1;
+		}
+	}
+
+	if (replay_path != nullptr)
+		return play_replay(replay_path) ? 0 : 1;
+	if (batch_envs > 0)
+		return check_batch(batch_envs, width, height, ticks, seed) ? 0 : 1;
+
+	ReplayWriter recorder;
+	if (record_path != nullptr && !recorder.open(record_path, width, height)) {
+		std::cerr << "couldn't open \"" << record_path << "\" to record to" << std::endl;
+		return 1;
+	}
+
+	RunStats stats;
+	const char* layout_name = "generic";
+	auto start = std::chrono::steady_clock::now();
+
+	if (use_autopilot || generic) { // the autopilot only knows the engine that takes any size
+		SnekEngine engine;
+		if (use_autopilot)
+			stats = run_games(engine, width, height, ticks, seed, recorder, [&](const SnekEngine& played) { return autopilot.decide(played); });
+		else
+			stats = run_games(engine, width, height, ticks, seed, recorder, [](const auto& played) { return choose_direction(played); });
+	}
+	else {
+		with_board_layout(width, height, [&](auto layout) {
+			BasicSnekEngine<decltype(layout)> engine;
+			stats = run_games(engine, width, height, ticks, seed, recorder, [](const auto& played) { return choose_direction(played); });
+			layout_name = decltype(layout)::fixed_size ? "fixed" : "generic";
+		});
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "board: " << width << "x" << height << " (" << layout_name << " layout), seed: " << seed << std::endl;
+	std::cout << "ticks: " << ticks << " in " << seconds << " s (" << (uint64_t)(ticks / (seconds > 0 ? seconds : 1e-9)) << " ticks/s)" << std::endl;
+	std::cout << "moves: " << stats.moves << ", foods eaten: " << stats.foods << ", games: " << stats.games << ", best score: " << stats.best_score << std::endl;
+	if (record_path != nullptr)
+		std::cout << "recorded " << recorder.turns_written << " turns of " << stats.games << " games in " << recorder.bytes_written << " bytes" << std::endl;
+	if (use_autopilot) {
+		std::cout << "autopilot: " << autopilot.decisions << " decisions, " << autopilot.shortcuts << " shortcuts to the food, "
+			<< autopilot.cells_expanded << " cells searched, " << autopilot.budget_overruns << " searches carried over (budget " << autopilot.budget_us << " us)" << std::endl;
+	}
+	return 0;
+}
\ No newline at end of file
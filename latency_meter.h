@@ -0,0 +1,108 @@
+#pragma once
+#include <SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// input to photon latency, or as close as the game can see: the time from a key going down (SDL's timestamp on the
+// event) until SDL_RenderPresent() returned for the first frame drawn after the key was handled. the display itself
+// adds a bit on top of that, which is the same with any setting here.
+// with --threaded another thread handles the keys, so they're numbered as they go over and a key only counts as on
+// screen once a frame that handled it was presented
+
+class LatencyMeter {
+	private:
+		static const size_t max_pending = 32; // keys handled but not on screen yet
+		static const size_t max_samples = 1 << 16; // the oldest are overwritten after that
+
+		struct PendingKey {
+			Uint64 down = 0; // performance counter
+			uint64_t sequence = 0;
+		};
+
+		Uint64 frequency = 1;
+		PendingKey pending[max_pending] = {};
+		size_t pending_count = 0;
+		std::vector<double> samples; // ms, used as a ring once full
+		size_t next_sample = 0;
+
+	public:
+		unsigned long long keys = 0;
+		unsigned long long dropped = 0; // keys that didn't fit in pending
+
+		LatencyMeter() {};
+
+		void start() {
+			frequency = SDL_GetPerformanceFrequency();
+			samples.reserve(max_samples); // nothing allocates while measuring
+			samples.clear();
+			next_sample = 0;
+			pending_count = 0;
+		}
+
+		// event_timestamp is the event's SDL_GetTicks() time, turned into the performance counter by how long ago it was.
+		// sequence is the key's number when it's handled on another thread, they have to go up
+		void key_down(Uint32 event_timestamp, uint64_t sequence = 0) {
+			keys++;
+			if (pending_count == max_pending) {
+				dropped++;
+				return;
+			}
+
+			Uint64 now = SDL_GetPerformanceCounter();
+			Uint32 age_ms = SDL_GetTicks() - event_timestamp;
+			Uint64 age = age_ms < 1000 ? (Uint64)age_ms * frequency / 1000 : 0; // a timestamp from the future or way back is junk
+			pending[pending_count].down = now > age ? now - age : now;
+			pending[pending_count].sequence = sequence;
+			pending_count++;
+		}
+
+		// right after SDL_RenderPresent() returned, every key handled before the frame was drawn is on screen now.
+		// handled is the number of the last key the frame handled, the keys after it stay pending
+		void presented(uint64_t handled = ~0ULL) {
+			if (pending_count == 0)
+				return;
+
+			Uint64 now = SDL_GetPerformanceCounter();
+			size_t shown = 0;
+			while (shown < pending_count && pending[shown].sequence <= handled) {
+				double ms = (double)(now - pending[shown].down) * 1000.0 / frequency;
+				if (samples.size() < max_samples)
+					samples.push_back(ms);
+				else {
+					samples[next_sample] = ms;
+					next_sample = (next_sample + 1) % max_samples;
+				}
+				shown++;
+			}
+
+			for (size_t i = shown; i < pending_count; i++)
+				pending[i - shown] = pending[i];
+			pending_count -= shown;
+		}
+
+		size_t sample_count() const {
+			return samples.size();
+		}
+
+		// p is between 0 and 1, only for reports since it sorts a copy
+		double percentile(double p) const {
+			if (samples.empty())
+				return 0.0;
+
+			std::vector<double> sorted(samples);
+			size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+			std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+			return sorted[index];
+		}
+
+		void report(std::ostream& out) const {
+			if (samples.empty()) {
+				out << "input to present latency: no keys pressed" << std::endl;
+				return;
+			}
+			out << "input to present latency over " << samples.size() << " keys: p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99)
+				<< " ms, max " << *std::max_element(samples.begin(), samples.end()) << " ms" << std::endl;
+		}
+};
\ No newline at end of file
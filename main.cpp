@@ -0,0 +1,7 @@
+#include "game.h"
+
+int main(int argc, char *args[]) {
+	Game game(GameOptions::parse(argc, args));
+	game.run();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// a whole file mapped read only into memory. nothing is copied, the os pages the file in as it's read,
+// so opening a big file costs the same as opening a small one. no SDL in here
+
+class MappedFile {
+	private:
+		const uint8_t* bytes = nullptr;
+		size_t length = 0;
+		bool opened = false;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#endif
+
+	public:
+		MappedFile() {};
+
+		~MappedFile() {
+			close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// false if the file can't be opened or mapped, an empty file opens fine with no bytes
+		bool open(const char* path) {
+			close();
+
+#ifdef _WIN32
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+
+			LARGE_INTEGER file_size;
+			if (!GetFileSizeEx(file, &file_size)) {
+				close();
+				return false;
+			}
+			length = (size_t)file_size.QuadPart;
+
+			if (length > 0) {
+				mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping == NULL) {
+					close();
+					return false;
+				}
+				bytes = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (bytes == nullptr) {
+					close();
+					return false;
+				}
+			}
+#else
+			int fd = ::open(path, O_RDONLY);
+			if (fd < 0)
+				return false;
+
+			struct stat info;
+			if (fstat(fd, &info) != 0) {
+				::close(fd);
+				return false;
+			}
+			length = (size_t)info.st_size;
+
+			if (length > 0) {
+				void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped == MAP_FAILED) {
+					::close(fd);
+					length = 0;
+					return false;
+				}
+				bytes = (const uint8_t*)mapped;
+			}
+			::close(fd); // the mapping stays valid without it
+#endif
+
+			opened = true;
+			return true;
+		}
+
+		void close() {
+#ifdef _WIN32
+			if (bytes != nullptr)
+				UnmapViewOfFile(bytes);
+			if (mapping != NULL)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = NULL;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (bytes != nullptr)
+				munmap((void*)bytes, length);
+#endif
+			bytes = nullptr;
+			length = 0;
+			opened = false;
+		}
+
+		bool is_open() const {
+			return opened;
+		}
+
+		const uint8_t* data() const {
+			return bytes;
+		}
+
+		size_t size() const {
+			return length;
+		}
+};
\ No newline at end of file
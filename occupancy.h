@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "snek.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// one bit per board cell that tells whether the snek is on it, so collision is a single bit test
+// and picking a free cell doesn't have to guess and retry.
+// the bits live in a std::vector sized by reset(), or for a board size known at compile time in a std::array
+// (FixedOccupancy), which for the 20x15 board is five words the loops over them are unrolled for
+
+inline unsigned int popcount64(uint64_t word) {
+#ifdef _MSC_VER
+	return (unsigned int)__popcnt64(word);
+#else
+	return (unsigned int)__builtin_popcountll(word);
+#endif
+}
+
+// index of the lowest set bit, word can't be 0
+inline unsigned int lowest_bit64(uint64_t word) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (unsigned int)index;
+#else
+	return (unsigned int)__builtin_ctzll(word);
+#endif
+}
+
+// index of the k-th (0 based) set bit in word, word must have more than k bits set
+inline unsigned int select64(uint64_t word, unsigned int k) {
+	unsigned int base = 0;
+
+	// narrow down to the byte first so this is at most a handful of steps
+	for (;;) {
+		unsigned int in_byte = popcount64(word & 0xFF);
+		if (k < in_byte)
+			break;
+		k -= in_byte;
+		word >>= 8;
+		base += 8;
+	}
+	for (;;) {
+		if (word & 1) {
+			if (k == 0)
+				return base;
+			k--;
+		}
+		word >>= 1;
+		base++;
+	}
+}
+
+inline void clear_words(std::vector<uint64_t>& words, size_t count) {
+	words.assign(count, 0);
+}
+
+// the array is already as big as it'll ever be
+template <size_t Count>
+inline void clear_words(std::array<uint64_t, Count>& words, size_t) {
+	words.fill(0);
+}
+
+template <class Words>
+class BasicOccupancy {
+	private:
+		Words words;
+		size_t cell_count = 0;
+		size_t occupied = 0;
+
+	public:
+		BasicOccupancy() {};
+
+		// clears the grid for a board of the given size, the bits past the last cell are kept set so they never look free
+		void reset(size_t cells) {
+			cell_count = cells;
+			occupied = 0;
+			clear_words(words, (cells + 63) / 64);
+
+			if (cells % 64 != 0)
+				words[(cells + 63) / 64 - 1] = ~0ULL << (cells % 64);
+		}
+
+		bool test(Cell cell) const {
+			return (words[cell >> 6] >> (cell & 63)) & 1;
+		}
+
+		void set(Cell cell) {
+			uint64_t bit = 1ULL << (cell & 63);
+			if (!(words[cell >> 6] & bit)) {
+				words[cell >> 6] |= bit;
+				occupied++;
+			}
+		}
+
+		void clear(Cell cell) {
+			uint64_t bit = 1ULL << (cell & 63);
+			if (words[cell >> 6] & bit) {
+				words[cell >> 6] &= ~bit;
+				occupied--;
+			}
+		}
+
+		size_t size() const {
+			return cell_count;
+		}
+
+		size_t free_count() const {
+			return cell_count - occupied;
+		}
+
+		// calls visit(cell) for every occupied cell in [first, last), a whole word of empty cells is skipped at once
+		template <class Visitor>
+		void for_each_set(Cell first, Cell last, Visitor&& visit) const {
+			for (Cell word_start = first & ~(Cell)63; word_start < last; word_start += 64) {
+				uint64_t bits = words[word_start >> 6];
+				if (word_start < first)
+					bits &= ~0ULL << (first - word_start);
+				if (last - word_start < 64)
+					bits &= ~(~0ULL << (last - word_start));
+
+				while (bits != 0) {
+					visit(word_start + (Cell)lowest_bit64(bits));
+					bits &= bits - 1;
+				}
+			}
+		}
+
+		// the k-th free cell in board order, k has to be smaller than free_count()
+		Cell nth_free(size_t k) const {
+			for (size_t i = 0; i < words.size(); i++) {
+				uint64_t free_bits = ~words[i];
+				unsigned int free_here = popcount64(free_bits);
+
+				if (k < free_here)
+					return (Cell)(i * 64 + select64(free_bits, (unsigned int)k));
+				k -= free_here;
+			}
+			return 0;
+		}
+};
+
+typedef BasicOccupancy<std::vector<uint64_t>> OccupancyGrid;
+
+template <size_t Cells>
+using FixedOccupancy = BasicOccupancy<std::array<uint64_t, (Cells + 63) / 64>>;
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// settings that can be changed from the command line, e.g. "snek --seed 1234"
+
+struct GameOptions {
+	bool has_seed = false;
+	uint64_t seed = 0;
+	bool always_redraw = false;
+	bool offscreen = false; // hidden window, software renderer and dummy drivers, for benchmarks and ci
+	bool vsync = true;
+	bool late_input = false; // waits until just before the vblank to take input and draw
+	bool measure_latency = false; // reports input to present latency on exit
+	bool smooth = true; // slides the snek from cell to cell instead of jumping
+	int target_fps = 0; // paces frames at this rate, 0 leaves it to vsync
+	bool threaded = false; // simulation, rendering and audio each on their own thread
+	int board_width = 20; // in tiles, anything bigger than the window scrolls
+	int board_height = 15;
+	bool autopilot = false; // the game plays itself
+	uint32_t autopilot_budget_us = 200; // search time per autopilot move
+	const char* trace_path = nullptr; // where to write the profiler trace on exit (SNEK_PROFILER builds only)
+	const char* record_path = "last_session.snekreplay"; // every game of the session goes in here, nullptr to not record
+	const char* replay_path = nullptr; // plays this replay instead of taking input
+	const char* pack_path = "snek.pack"; // the asset pack, nullptr or a missing file means the loose files
+	double replay_speed = 1.0; // 2 plays the replay twice as fast
+	uint64_t replay_seek = 0; // tick of the whole replay to skip to before showing anything
+	uint32_t rewind_memory_kb = 1024; // how much of the game can be rewound, 0 for none
+
+	static const int max_board_side = 4096;
+
+	static GameOptions parse(int argc, char* argv[]) {
+		GameOptions options;
+
+		for (int i = 1; i < argc; i++) {
+			if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+				options.has_seed = true;
+				options.seed = strtoull(argv[++i], nullptr, 10);
+			}
+			else if (strcmp(argv[i], "--always-redraw") == 0)
+				options.always_redraw = true;
+			else if (strcmp(argv[i], "--offscreen") == 0)
+				options.offscreen = true;
+			else if (strcmp(argv[i], "--no-vsync") == 0)
+				options.vsync = false;
+			else if (strcmp(argv[i], "--low-latency") == 0)
+				options.late_input = true;
+			else if (strcmp(argv[i], "--latency") == 0)
+				options.measure_latency = true;
+			else if (strcmp(argv[i], "--no-smooth") == 0)
+				options.smooth = false;
+			else if (strcmp(argv[i], "--threaded") == 0)
+				options.threaded = true;
+			else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+				int fps = atoi(argv[++i]);
+				if (fps >= 1 && fps <= 1000)
+					options.target_fps = fps;
+				else
+					std::cerr << "--fps expects a frame rate from 1 to 1000, e.g. 144" << std::endl;
+			}
+			else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+				int width = 0, height = 0;
+				if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 2 || height < 2 || width > max_board_side || height > max_board_side)
+					std::cerr << "--board expects WIDTHxHEIGHT between 2x2 and " << max_board_side << "x" << max_board_side << ", e.g. 20x15" << std::endl;
+				else {
+					options.board_width = width;
+					options.board_height = height;
+				}
+			}
+			else if (strcmp(argv[i], "--autopilot") == 0)
+				options.autopilot = true;
+			else if (strcmp(argv[i], "--autopilot-budget") == 0 && i + 1 < argc)
+				options.autopilot_budget_us = (uint32_t)strtoul(argv[++i], nullptr, 10);
+			else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+				options.trace_path = argv[++i];
+			else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+				options.record_path = argv[++i];
+			else if (strcmp(argv[i], "--no-record") == 0)
+				options.record_path = nullptr;
+			else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+				options.pack_path = argv[++i];
+			else if (strcmp(argv[i], "--no-pack") == 0)
+				options.pack_path = nullptr;
+			else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+				options.replay_path = argv[++i];
+			else if (strcmp(argv[i], "--replay-speed") == 0 && i + 1 < argc) {
+				double speed = strtod(argv[++i], nullptr);
+				if (speed > 0)
+					options.replay_speed = speed;
+				else
+					std::cerr << "--replay-speed expects a number above 0, e.g. 4" << std::endl;
+			}
+			else if (strcmp(argv[i], "--replay-seek") == 0 && i + 1 < argc)
+				options.replay_seek = strtoull(argv[++i], nullptr, 10);
+			else if (strcmp(argv[i], "--rewind-memory") == 0 && i + 1 < argc)
+				options.rewind_memory_kb = (uint32_t)strtoul(argv[++i], nullptr, 10);
+			else
+				std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+		}
+		return options;
+	}
+};
\ No newline at end of file
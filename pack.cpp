@@ -0,0 +1,160 @@
+#include <SDL.h>
+#include <SDL_image.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "asset_pack.h"
+
+// builds the asset pack the game maps at startup (see asset_pack.h). pngs are decoded here once so the game never has to,
+// and the wavs under sfx/ are converted to the mixer's format. music is streamed, so it goes in as it is like everything
+// else. the names are the paths as given, so run it from the repository root, e.g.
+// "snek_pack snek.pack sprites/*.png fonts/*.ttf music/*.wav sfx/*.wav"
+
+struct PackInput {
+	std::string name;
+	uint8_t kind = AssetPack::entry_file;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> bytes;
+	uint64_t offset = 0;
+};
+
+static bool ends_with(const std::string& text, const char* suffix) {
+	size_t length = strlen(suffix);
+	return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static bool read_input(const char* path, PackInput& input) {
+	input.name = path;
+
+	if (ends_with(input.name, ".png")) {
+		SDL_Surface* loaded = IMG_Load(path);
+		SDL_Surface* image = loaded != NULL ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0) : NULL;
+		if (loaded != NULL)
+			SDL_FreeSurface(loaded);
+		if (image == NULL) {
+			std::cerr << "couldn't decode \"" << path << "\": " << IMG_GetError() << std::endl;
+			return false;
+		}
+
+		// the rows go in without the surface's padding
+		input.kind = AssetPack::entry_image;
+		input.width = (uint32_t)image->w;
+		input.height = (uint32_t)image->h;
+		input.bytes.resize((size_t)image->w * image->h * 4);
+		for (int y = 0; y < image->h; y++)
+			memcpy(&input.bytes[(size_t)y * image->w * 4], (const uint8_t*)image->pixels + (size_t)y * image->pitch, (size_t)image->w * 4);
+		SDL_FreeSurface(image);
+		return true;
+	}
+
+	if (input.name.compare(0, 4, "sfx/") == 0 && ends_with(input.name, ".wav")) {
+		SDL_AudioSpec spec;
+		Uint8* samples = nullptr;
+		Uint32 length = 0;
+		SDL_AudioCVT convert;
+		if (SDL_LoadWAV(path, &spec, &samples, &length) == NULL) {
+			std::cerr << "couldn't decode \"" << path << "\": " << SDL_GetError() << std::endl;
+			return false;
+		}
+		if (SDL_BuildAudioCVT(&convert, spec.format, spec.channels, spec.freq, AssetPack::sound_format, AssetPack::sound_channels, AssetPack::sound_frequency) < 0) {
+			std::cerr << "couldn't convert \"" << path << "\": " << SDL_GetError() << std::endl;
+			SDL_FreeWAV(samples);
+			return false;
+		}
+
+		// the conversion happens in place in a buffer big enough for the longer of the two
+		convert.len = (int)length;
+		input.bytes.resize((size_t)length * convert.len_mult);
+		memcpy(input.bytes.data(), samples, length);
+		SDL_FreeWAV(samples);
+		convert.buf = input.bytes.data();
+		if (convert.needed && SDL_ConvertAudio(&convert) < 0) {
+			std::cerr << "couldn't convert \"" << path << "\": " << SDL_GetError() << std::endl;
+			return false;
+		}
+		input.bytes.resize(convert.needed ? (size_t)convert.len_cvt : (size_t)length);
+
+		input.kind = AssetPack::entry_sound;
+		input.width = (uint32_t)AssetPack::sound_frequency;
+		input.height = (uint32_t)AssetPack::sound_channels;
+		return true;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "couldn't open \"" << path << "\"" << std::endl;
+		return false;
+	}
+	input.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+template <class T>
+static void put(std::vector<uint8_t>& out, T value) {
+	const uint8_t* bytes = (const uint8_t*)&value; // the pack is little endian, like everything it runs on
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "usage: snek_pack <pack file> <asset files...>" << std::endl;
+		return 1;
+	}
+
+	std::vector<PackInput> inputs(argc - 2);
+	for (int i = 2; i < argc; i++) {
+		if (!read_input(argv[i], inputs[i - 2]))
+			return 1;
+	}
+
+	// the index first, its size decides where the data starts
+	size_t index_size = 12;
+	for (const PackInput& input : inputs)
+		index_size += 2 + input.name.size() + 1 + 4 + 4 + 8 + 8;
+
+	uint64_t offset = index_size;
+	for (PackInput& input : inputs) {
+		offset = (offset + AssetPack::alignment - 1) / AssetPack::alignment * AssetPack::alignment;
+		input.offset = offset;
+		offset += input.bytes.size();
+	}
+
+	std::vector<uint8_t> out;
+	out.reserve((size_t)offset);
+	out.insert(out.end(), { 'S', 'N', 'K', 'P' });
+	put<uint32_t>(out, AssetPack::version);
+	put<uint32_t>(out, (uint32_t)inputs.size());
+
+	for (const PackInput& input : inputs) {
+		put<uint16_t>(out, (uint16_t)input.name.size());
+		out.insert(out.end(), input.name.begin(), input.name.end());
+		put<uint8_t>(out, input.kind);
+		put<uint32_t>(out, input.width);
+		put<uint32_t>(out, input.height);
+		put<uint64_t>(out, input.offset);
+		put<uint64_t>(out, (uint64_t)input.bytes.size());
+	}
+
+	for (const PackInput& input : inputs) {
+		out.resize((size_t)input.offset, 0);
+		out.insert(out.end(), input.bytes.begin(), input.bytes.end());
+	}
+
+	FILE* file = fopen(argv[1], "wb");
+	if (file == nullptr || fwrite(out.data(), 1, out.size(), file) != out.size()) {
+		std::cerr << "couldn't write \"" << argv[1] << "\"" << std::endl;
+		if (file != nullptr)
+			fclose(file);
+		return 1;
+	}
+	fclose(file);
+
+	std::cout << "packed " << inputs.size() << " assets into \"" << argv[1] << "\", " << out.size() << " bytes" << std::endl;
+	return 0;
+}
\ No newline at end of file
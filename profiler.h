@@ -0,0 +1,164 @@
+#pragma once
+
+// a small frame profiler. build with -DSNEK_PROFILER to turn it on, without it every macro below expands to nothing.
+// SNEK_PROFILE_ZONE("name") times the rest of the enclosing scope and SNEK_PROFILE_DRAW_CALLS(n) counts draw calls.
+// every thread writes its zones into its own fixed size ring buffer (no locks, no allocations after the first zone),
+// and the last zones of every thread can be written out as a chrome trace_event json file (open it in chrome://tracing or perfetto)
+
+#ifdef SNEK_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ProfileEvent {
+	const char* name = nullptr; // has to be a string literal, only the pointer is kept
+	uint64_t start = 0; // ns since the profiler started
+	uint64_t end = 0;
+};
+
+// single producer (the owning thread), anyone can read a snapshot of it while it keeps going. a slot is only ever
+// half written while the ring laps it, so the writer says which event it's starting on before touching the slot and
+// the reader drops whatever the writer may have started overwriting while it was copying (a seqlock, one per ring)
+class ProfileRing {
+	public:
+		static const size_t capacity = 1 << 16; // has to be a power of two
+
+	private:
+		struct Slot {
+			std::atomic<const char*> name { nullptr };
+			std::atomic<uint64_t> start { 0 };
+			std::atomic<uint64_t> end { 0 };
+		};
+
+		Slot slots[capacity];
+		std::atomic<uint64_t> started { 0 }; // events the writer has begun to write
+		std::atomic<uint64_t> written { 0 }; // events that are all there
+
+	public:
+		unsigned int thread_id = 0;
+
+		void push(const ProfileEvent& event) {
+			uint64_t n = written.load(std::memory_order_relaxed);
+			started.store(n + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release); // nobody sees the slot change without seeing started first
+
+			Slot& slot = slots[n & (capacity - 1)];
+			slot.name.store(event.name, std::memory_order_relaxed);
+			slot.start.store(event.start, std::memory_order_relaxed);
+			slot.end.store(event.end, std::memory_order_relaxed);
+			written.store(n + 1, std::memory_order_release);
+		}
+
+		// the last events in order, appended to out. the oldest ones can go missing if the writer laps them meanwhile
+		void snapshot(std::vector<ProfileEvent>& out) const {
+			uint64_t end = written.load(std::memory_order_acquire);
+			uint64_t begin = end > capacity ? end - capacity : 0;
+			size_t first = out.size();
+
+			for (uint64_t i = begin; i < end; i++) {
+				const Slot& slot = slots[i & (capacity - 1)];
+				ProfileEvent event;
+				event.name = slot.name.load(std::memory_order_relaxed);
+				event.start = slot.start.load(std::memory_order_relaxed);
+				event.end = slot.end.load(std::memory_order_relaxed);
+				out.push_back(event);
+			}
+
+			// event i is only intact if the one that overwrites it, i + capacity, hadn't started yet
+			std::atomic_thread_fence(std::memory_order_acquire);
+			uint64_t lapped = started.load(std::memory_order_relaxed);
+			uint64_t valid = lapped > capacity ? lapped - capacity : 0;
+			if (valid > begin)
+				out.erase(out.begin() + first, out.begin() + first + (size_t)(valid - begin < end - begin ? valid - begin : end - begin));
+		}
+};
+
+class Profiler {
+	private:
+		std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		std::mutex rings_mutex; // only taken when a thread records its first zone and when exporting
+		std::vector<std::unique_ptr<ProfileRing>> rings;
+
+	public:
+		std::atomic<uint64_t> draw_calls { 0 };
+
+		static Profiler& instance() {
+			static Profiler profiler;
+			return profiler;
+		}
+
+		uint64_t now() const {
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+		}
+
+		ProfileRing& thread_ring() {
+			thread_local ProfileRing* ring = nullptr;
+			if (ring == nullptr) {
+				std::lock_guard<std::mutex> lock(rings_mutex);
+				rings.emplace_back(new ProfileRing());
+				ring = rings.back().get();
+				ring->thread_id = (unsigned int)rings.size();
+			}
+			return *ring;
+		}
+
+		// writes whatever is still in the ring buffers as a chrome trace, returns false if the file couldn't be written
+		bool write_chrome_trace(const char* path) {
+			FILE* file = fopen(path, "w");
+			if (file == nullptr)
+				return false;
+
+			fprintf(file, "{\"traceEvents\":[\n");
+			bool first = true;
+
+			std::lock_guard<std::mutex> lock(rings_mutex);
+			std::vector<ProfileEvent> events;
+			events.reserve(ProfileRing::capacity);
+			for (auto& ring : rings) {
+				events.clear();
+				ring->snapshot(events); // copied first, the ring keeps moving while the file is written
+
+				for (const ProfileEvent& event : events) {
+					fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+						first ? "" : ",\n", event.name, ring->thread_id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+					first = false;
+				}
+			}
+
+			fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+			return fclose(file) == 0;
+		}
+};
+
+class ProfileZone {
+	private:
+		ProfileEvent event;
+
+	public:
+		explicit ProfileZone(const char* name) {
+			event.name = name;
+			event.start = Profiler::instance().now();
+		}
+
+		~ProfileZone() {
+			event.end = Profiler::instance().now();
+			Profiler::instance().thread_ring().push(event);
+		}
+};
+
+#define SNEK_PROFILE_CONCAT_INNER(a, b) a##b
+#define SNEK_PROFILE_CONCAT(a, b) SNEK_PROFILE_CONCAT_INNER(a, b)
+#define SNEK_PROFILE_ZONE(name) ProfileZone SNEK_PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define SNEK_PROFILE_DRAW_CALLS(count) Profiler::instance().draw_calls.fetch_add((count), std::memory_order_relaxed)
+
+#else
+
+#define SNEK_PROFILE_ZONE(name) ((void)0)
+#define SNEK_PROFILE_DRAW_CALLS(count) ((void)0)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+// keeps track of whether anything visible changed since the last present, so the main loop can sleep
+// until the next input or timer instead of redrawing the same frame every vsync.
+// with --threaded the simulation thread invalidates while the render thread draws, so the flag is atomic, and every
+// invalidate() also bumps a counter that goes out with each published frame (see Game::run_threaded())
+
+class RedrawScheduler {
+	private:
+		std::atomic<bool> dirty { true };
+		std::atomic<uint64_t> changes { 0 };
+		Uint64 frequency = 1;
+		Uint64 started = 0;
+		Uint64 idle = 0; // performance counter ticks spent sleeping in wait()
+
+	public:
+		bool always_redraw = false; // draw every iteration like before, for when something animates between ticks
+		int refresh_rate = 60; // what the display would have been redrawn at, for counting skipped frames
+		unsigned long long frames_presented = 0;
+
+		RedrawScheduler() {};
+
+		void start() {
+			frequency = SDL_GetPerformanceFrequency();
+			started = SDL_GetPerformanceCounter();
+			idle = 0;
+		}
+
+		// something visible changed, the next loop iteration has to draw
+		void invalidate() {
+			dirty.store(true, std::memory_order_relaxed);
+			changes.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// goes up with every invalidate(), a frame that was captured at a different count is out of date
+		uint64_t change_count() const {
+			return changes.load(std::memory_order_relaxed);
+		}
+
+		bool should_draw() const {
+			return dirty.load(std::memory_order_relaxed) || always_redraw;
+		}
+
+		void presented() {
+			dirty.store(false, std::memory_order_relaxed);
+			frames_presented++;
+		}
+
+		// sleeps until an event arrives or timeout_ms passed, without taking the event off the queue
+		void wait(int timeout_ms) {
+			if (timeout_ms <= 0)
+				return;
+
+			Uint64 before = SDL_GetPerformanceCounter();
+			SDL_WaitEventTimeout(NULL, timeout_ms);
+			idle += SDL_GetPerformanceCounter() - before;
+		}
+
+		double seconds_running() const {
+			return (double)(SDL_GetPerformanceCounter() - started) / frequency;
+		}
+
+		// frames a redraw-every-vsync loop would have presented that we didn't
+		unsigned long long frames_skipped() const {
+			double would_have_presented = seconds_running() * refresh_rate;
+			return would_have_presented > frames_presented ? (unsigned long long)(would_have_presented - frames_presented) : 0;
+		}
+
+		// share of wall time the main loop spent doing something instead of sleeping
+		double busy_ratio() const {
+			Uint64 total = SDL_GetPerformanceCounter() - started;
+			return total > 0 ? 1.0 - (double)idle / total : 0.0;
+		}
+
+		void report(std::ostream& out) const {
+			out << "frames presented: " << frames_presented << ", frames skipped: " << frames_skipped()
+				<< " (at " << refresh_rate << " Hz), main loop busy " << (int)(busy_ratio() * 100.0 + 0.5) << "% of "
+				<< seconds_running() << " s" << std::endl;
+		}
+};
\ No newline at end of file
@@ -0,0 +1,335 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "engine.h"
+#include "mapped_file.h"
+
+// replays: the engine only ever changes through reset(seed), tick() and turn(), so a game is its seed plus the tick
+// every turn happened on. no SDL in here, the game and the headless runner both read and write them.
+//
+// the file is "SNKR", a version byte and the board width and height as varints, then records. every record starts
+// with a varint whose low 3 bits say what it is and whose other bits are the ticks since the game's previous record:
+//   0-3  a turn up, down, left or right, made right before the engine's tick with that number
+//   4    a new game, followed by the engine seed as a varint
+//   5    the recording of the game stops here (the snek died or the game was left), followed by the score as a varint
+// a turn up to ~10 seconds after the one before takes 2 bytes. the file is only ever appended to and flushed after
+// every game, so a crash loses the game being played at most and everything before it still plays back
+
+enum ReplayRecord : uint8_t {
+	REPLAY_TURN_UP = 0,
+	REPLAY_TURN_DOWN = 1,
+	REPLAY_TURN_LEFT = 2,
+	REPLAY_TURN_RIGHT = 3,
+	REPLAY_GAME_START = 4,
+	REPLAY_GAME_END = 5
+};
+
+struct ReplayFormat {
+	static const uint8_t version = 1;
+	static const int record_bits = 3;
+
+	// little endian base 128, 7 bits per byte and the top bit set on every byte but the last
+	static size_t put_varint(uint8_t* out, uint64_t value) {
+		size_t length = 0;
+		while (value >= 0x80) {
+			out[length++] = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		out[length++] = (uint8_t)value;
+		return length;
+	}
+
+	// false if the data ends in the middle of the varint or it's too long to be one
+	static bool get_varint(const uint8_t* data, size_t size, size_t& offset, uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64 && offset < size; shift += 7) {
+			uint8_t byte = data[offset++];
+			value |= (uint64_t)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	static uint8_t turn_record(NodeDirection dir) {
+		return (uint8_t)((int)dir - (int)NodeDirection::UP);
+	}
+
+	static NodeDirection record_direction(uint64_t record) {
+		return (NodeDirection)((int)NodeDirection::UP + (int)(record & 3));
+	}
+};
+
+class ReplayWriter {
+	private:
+		FILE* file = nullptr;
+		uint64_t last_tick = 0; // of the game's previous record
+
+		void put_record(uint64_t tick, ReplayRecord kind, const uint64_t* extra = nullptr) {
+			uint8_t buffer[20];
+			size_t length = ReplayFormat::put_varint(buffer, ((tick - last_tick) << ReplayFormat::record_bits) | kind);
+			if (extra != nullptr)
+				length += ReplayFormat::put_varint(buffer + length, *extra);
+			last_tick = tick;
+
+			fwrite(buffer, 1, length, file);
+			bytes_written += length;
+		}
+
+	public:
+		uint64_t bytes_written = 0;
+		uint64_t turns_written = 0;
+		bool in_game = false;
+
+		ReplayWriter() {};
+
+		~ReplayWriter() {
+			close();
+		}
+
+		ReplayWriter(const ReplayWriter&) = delete;
+		ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+		// starts a new file, every game of the session goes into it
+		bool open(const char* path, int board_width, int board_height) {
+			close();
+			file = fopen(path, "wb");
+			if (file == nullptr)
+				return false;
+
+			uint8_t header[25] = { 'S', 'N', 'K', 'R', ReplayFormat::version };
+			size_t length = 5;
+			length += ReplayFormat::put_varint(header + length, (uint64_t)board_width);
+			length += ReplayFormat::put_varint(header + length, (uint64_t)board_height);
+			fwrite(header, 1, length, file);
+			fflush(file);
+
+			bytes_written = length;
+			turns_written = 0;
+			in_game = false;
+			return true;
+		}
+
+		// a game that's still going is written as stopped where it is
+		void close(uint64_t tick = 0, unsigned int score = 0) {
+			if (file == nullptr)
+				return;
+			if (in_game)
+				end_game(tick, score);
+			fclose(file);
+			file = nullptr;
+		}
+
+		bool is_open() const {
+			return file != nullptr;
+		}
+
+		// right after the engine was reset with seed
+		void begin_game(uint64_t seed) {
+			if (file == nullptr)
+				return;
+			last_tick = 0;
+			put_record(0, REPLAY_GAME_START, &seed);
+			in_game = true;
+		}
+
+		// tick is the engine's tick_count when it turned, only turns that changed something need to be written
+		void record_turn(uint64_t tick, NodeDirection dir) {
+			if (file == nullptr || !in_game)
+				return;
+			put_record(tick, (ReplayRecord)ReplayFormat::turn_record(dir));
+			turns_written++;
+		}
+
+		void end_game(uint64_t tick, unsigned int score) {
+			if (file == nullptr || !in_game)
+				return;
+			uint64_t extra = score;
+			put_record(tick, REPLAY_GAME_END, &extra);
+			in_game = false;
+			fflush(file); // everything up to here survives a crash
+		}
+};
+
+struct ReplayGame {
+	uint64_t seed = 0;
+	size_t first_record = 0; // offset of the record after the game start
+	uint64_t turns = 0;
+	uint64_t end_tick = 0; // where the recording stopped, the last turn for a game that was cut off without an end record
+	unsigned int score = 0;
+	bool finished = false; // has an end record
+};
+
+// maps a replay file and indexes its games in one pass over the records, the turns are only decoded while playing
+class ReplayReader {
+	private:
+		MappedFile file;
+
+	public:
+		int board_width = 0;
+		int board_height = 0;
+		size_t header_size = 0;
+		std::vector<ReplayGame> games;
+
+		ReplayReader() {};
+
+		// false if the file is missing or isn't a replay. a file that was cut off is read up to the last whole record
+		bool open(const char* path) {
+			games.clear();
+			if (!file.open(path))
+				return false;
+
+			const uint8_t* data = file.data();
+			size_t size = file.size();
+			if (size < 5 || data[0] != 'S' || data[1] != 'N' || data[2] != 'K' || data[3] != 'R' || data[4] != ReplayFormat::version)
+				return false;
+
+			size_t offset = 5;
+			uint64_t width = 0, height = 0;
+			if (!ReplayFormat::get_varint(data, size, offset, width) || !ReplayFormat::get_varint(data, size, offset, height) || width < 2 || height < 2
+				|| width > 65536 || height > 65536)
+				return false;
+			board_width = (int)width;
+			board_height = (int)height;
+			header_size = offset;
+
+			uint64_t record = 0, extra = 0, tick = 0;
+			while (ReplayFormat::get_varint(data, size, offset, record)) {
+				unsigned int kind = (unsigned int)(record & ((1 << ReplayFormat::record_bits) - 1));
+
+				if (kind == REPLAY_GAME_START) {
+					if (!ReplayFormat::get_varint(data, size, offset, extra))
+						break;
+					ReplayGame game;
+					game.seed = extra;
+					game.first_record = offset;
+					games.push_back(game);
+					tick = 0;
+					continue;
+				}
+				if (games.empty() || games.back().finished)
+					break; // turns outside of a game, the rest can't be trusted
+
+				tick += record >> ReplayFormat::record_bits;
+				if (kind <= REPLAY_TURN_RIGHT) {
+					games.back().turns++;
+					games.back().end_tick = tick;
+				}
+				else if (kind == REPLAY_GAME_END) {
+					if (!ReplayFormat::get_varint(data, size, offset, extra))
+						break;
+					games.back().end_tick = tick;
+					games.back().score = (unsigned int)extra;
+					games.back().finished = true;
+				}
+				else
+					break;
+			}
+			return true;
+		}
+
+		const uint8_t* data() const {
+			return file.data();
+		}
+
+		size_t size() const {
+			return file.size();
+		}
+
+		uint64_t total_turns() const {
+			uint64_t turns = 0;
+			for (const ReplayGame& game : games)
+				turns += game.turns;
+			return turns;
+		}
+};
+
+// steps through the turns of one game of a replay. the front-end asks for the turns due before every engine tick and
+// applies them however it likes, fast_forward() does both with nothing else in between
+class ReplayPlayer {
+	private:
+		const ReplayReader* reader = nullptr;
+		size_t offset = 0; // of the next record
+		uint64_t record_tick = 0; // of the last record read
+		bool has_turn = false;
+		uint64_t turn_tick = 0;
+		NodeDirection turn_direction = NodeDirection::UP;
+
+		// decodes the next turn of the game, if there is one
+		void read_turn() {
+			has_turn = false;
+			uint64_t record = 0;
+			if (!ReplayFormat::get_varint(reader->data(), reader->size(), offset, record))
+				return;
+
+			unsigned int kind = (unsigned int)(record & ((1 << ReplayFormat::record_bits) - 1));
+			if (kind > REPLAY_TURN_RIGHT)
+				return; // the end of this game (or the start of the next one)
+
+			record_tick += record >> ReplayFormat::record_bits;
+			turn_tick = record_tick;
+			turn_direction = ReplayFormat::record_direction(record);
+			has_turn = true;
+		}
+
+	public:
+		size_t game = 0;
+
+		ReplayPlayer() {};
+
+		// resets the engine the way the recorded game started
+		void start(const ReplayReader& replay, size_t game_index, SnekEngine& engine) {
+			reader = &replay;
+			game = game_index;
+			const ReplayGame& recorded = replay.games[game];
+			engine.reset(replay.board_width, replay.board_height, recorded.seed);
+
+			offset = recorded.first_record;
+			record_tick = 0;
+			read_turn();
+		}
+
+		// the next turn made right before the engine's coming tick, call it until it returns false
+		bool next_turn(const SnekEngine& engine, NodeDirection& dir) {
+			if (!has_turn || turn_tick != engine.tick_count)
+				return false;
+			dir = turn_direction;
+			read_turn();
+			return true;
+		}
+
+		// ticks before the next turn is due, ~0 if the game has no more turns
+		uint64_t ticks_until_turn(const SnekEngine& engine) const {
+			if (!has_turn)
+				return ~0ULL;
+			return turn_tick > engine.tick_count ? turn_tick - engine.tick_count : 0;
+		}
+
+		// the recording of this game is over
+		bool done(const SnekEngine& engine) const {
+			return !engine.alive || engine.tick_count >= reader->games[game].end_tick;
+		}
+
+		// whether the game ended the way it was recorded, only meaningful once done()
+		bool matches(const SnekEngine& engine) const {
+			const ReplayGame& recorded = reader->games[game];
+			return !recorded.finished || (engine.tick_count == recorded.end_tick && engine.score == recorded.score);
+		}
+
+		// plays the game without a front-end until the engine reaches tick or the recording is over, returns the events
+		unsigned int fast_forward(SnekEngine& engine, uint64_t tick) {
+			unsigned int events = ENGINE_NONE;
+			NodeDirection dir;
+
+			while (engine.tick_count < tick && !done(engine)) {
+				while (next_turn(engine, dir))
+					events |= engine.turn(dir);
+				if (done(engine))
+					break; // died turning, that tick never happened
+				events |= engine.tick();
+			}
+			return events;
+		}
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "engine.h"
+#include "replay.h"
+
+// the last stretch of a game kept in a fixed amount of memory, so it can be rewound to any tick in it.
+// every keyframe_interval ticks a keyframe is written: the EngineState as it is, then the body as one 4 bit code per
+// segment (0-3 the direction it is from the segment before, 4 the same cell as a tail that hasn't unfolded yet).
+// between keyframes only the turns go in, as varints of ((ticks since the last turn) << 2 | direction) like the replays,
+// the engine gets everywhere else from those by itself. a keyframe and the turns after it are a segment, and the
+// segments are written one after another through the buffer, starting over at the front whenever the next one doesn't
+// fit at the end and dropping the oldest ones in the way. seeking restores the newest keyframe at or before the tick
+// and simulates the rest, which is keyframe_interval ticks at most
+
+class RewindBuffer {
+	private:
+		struct Segment {
+			size_t offset = 0;
+			size_t size = 0;
+			uint64_t tick = 0; // of the keyframe
+			uint64_t last_turn_tick = 0;
+		};
+
+		static const size_t max_turn_bytes = 10;
+
+		std::vector<uint8_t> bytes;
+		std::vector<Segment> segments; // a ring, the oldest at first_segment
+		size_t first_segment = 0;
+		size_t segment_count = 0;
+		uint64_t recorded_tick = 0; // the newest tick that can be gone back to
+		bool too_big = false; // the last keyframe didn't fit in the whole buffer, nothing more until the next game
+
+		Segment& segment(size_t i) {
+			return segments[(first_segment + i) % segments.size()];
+		}
+
+		const Segment& segment(size_t i) const {
+			return segments[(first_segment + i) % segments.size()];
+		}
+
+		void drop_oldest() {
+			first_segment = (first_segment + 1) % segments.size();
+			segment_count--;
+			evicted++;
+		}
+
+		// size bytes at offset, dropping the oldest segments that are in the way. keep is how many of the newest can't go
+		void make_room(size_t offset, size_t size, size_t keep) {
+			while (segment_count > keep && segment(0).offset < offset + size && offset < segment(0).offset + segment(0).size)
+				drop_oldest();
+		}
+
+		template <class Engine>
+		void write_keyframe(const Engine& engine) {
+			size_t length = engine.snek.size();
+			size_t size = sizeof(EngineState) + length / 2; // length - 1 codes, two to a byte
+			if (size + max_turn_bytes > bytes.size()) {
+				clear();
+				too_big = true;
+				return;
+			}
+
+			size_t offset = 0;
+			if (segment_count > 0) {
+				offset = segment(segment_count - 1).offset + segment(segment_count - 1).size;
+				if (offset + size + max_turn_bytes > bytes.size()) {
+					while (segment_count > 0 && segment(0).offset >= offset)
+						drop_oldest(); // the end of the buffer is left empty this time around, whatever was still there is the oldest
+					offset = 0;
+				}
+			}
+			make_room(offset, size, 0);
+			if (segment_count == segments.size())
+				drop_oldest();
+
+			EngineState state;
+			engine.save_state(state);
+			uint8_t* out = &bytes[offset];
+			memcpy(out, &state, sizeof(state));
+			out += sizeof(state);
+			memset(out, 0, length / 2);
+
+			const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+			Cell previous = engine.snek.head();
+			for (size_t i = 1; i < length; i++) {
+				Cell cell = engine.snek.at(i);
+				uint8_t code = 4;
+				if (cell != previous) {
+					for (code = 0; code < 4 && engine.neighbour_cell(previous, directions[code]) != cell; code++)
+						;
+				}
+				out[(i - 1) / 2] |= (uint8_t)(code << ((i - 1) % 2 * 4));
+				previous = cell;
+			}
+
+			Segment& added = segment(segment_count++);
+			added.offset = offset;
+			added.size = size;
+			added.tick = engine.tick_count;
+			added.last_turn_tick = engine.tick_count;
+			keyframes++;
+		}
+
+		// the newest keyframe at or before tick and the turns up to it, index is the keyframe's segment and end where
+		// the turns from tick on start in it
+		template <class Engine>
+		bool restore(Engine& engine, uint64_t tick, size_t& index, size_t& end, uint64_t& last_turn_tick) const {
+			if (segment_count == 0 || tick < segment(0).tick || tick > recorded_tick)
+				return false;
+
+			index = segment_count - 1;
+			while (segment(index).tick > tick)
+				index--;
+			const Segment& found = segment(index);
+			const uint8_t* data = &bytes[found.offset];
+
+			EngineState state;
+			memcpy(&state, data, sizeof(state));
+			const uint8_t* body = data + sizeof(state);
+			Cell cell = state.head;
+			engine.restore_state(state, [&](uint32_t i) {
+				uint8_t code = (body[(i - 1) / 2] >> ((i - 1) % 2 * 4)) & 0xF;
+				if (code < 4)
+					cell = engine.neighbour_cell(cell, (NodeDirection)(code + (int)NodeDirection::UP));
+				return cell;
+			});
+
+			size_t offset = sizeof(state) + state.snek_length / 2;
+			uint64_t turn_tick = found.tick;
+			last_turn_tick = found.tick;
+			end = found.size;
+			while (offset < found.size) {
+				size_t record = offset;
+				uint64_t value = 0;
+				ReplayFormat::get_varint(data, found.size, offset, value);
+				if (turn_tick + (value >> 2) >= tick) { // turns on the tick itself come after it
+					end = record;
+					break;
+				}
+				turn_tick += value >> 2;
+				while (engine.tick_count < turn_tick)
+					engine.tick();
+				engine.turn((NodeDirection)((value & 3) + (int)NodeDirection::UP));
+				last_turn_tick = turn_tick;
+			}
+			while (engine.tick_count < tick)
+				engine.tick();
+			return true;
+		}
+
+	public:
+		uint32_t keyframe_interval = 200; // ticks, a second of the game
+		unsigned long long keyframes = 0; // written
+		unsigned long long evicted = 0; // segments dropped to make room for newer ones
+
+		RewindBuffer() {};
+
+		// the buffer is allocated here once, memory_cap covers the segments and their index
+		void configure(size_t memory_cap) {
+			size_t slots = memory_cap / (sizeof(EngineState) + sizeof(Segment));
+			segments.assign(slots > 0 ? slots : 1, Segment());
+			bytes.assign(memory_cap > segments.size() * sizeof(Segment) ? memory_cap - segments.size() * sizeof(Segment) : 0, 0);
+			clear();
+		}
+
+		// forgets everything, for a new game
+		void clear() {
+			first_segment = 0;
+			segment_count = 0;
+			recorded_tick = 0;
+			too_big = false;
+		}
+
+		bool empty() const {
+			return segment_count == 0;
+		}
+
+		uint64_t oldest_tick() const {
+			return segment_count > 0 ? segment(0).tick : 0;
+		}
+
+		uint64_t newest_tick() const {
+			return recorded_tick;
+		}
+
+		size_t bytes_used() const {
+			size_t used = 0;
+			for (size_t i = 0; i < segment_count; i++)
+				used += segment(i).size;
+			return used;
+		}
+
+		// right after the engine was reset and after each of its ticks
+		template <class Engine>
+		void record_tick(const Engine& engine) {
+			if (bytes.empty() || too_big)
+				return;
+			if (segment_count == 0 || engine.tick_count - segment(segment_count - 1).tick >= keyframe_interval)
+				write_keyframe(engine);
+			recorded_tick = engine.tick_count;
+		}
+
+		// right before engine.turn(dir), for turns that change something
+		template <class Engine>
+		void record_turn(const Engine& engine, NodeDirection dir) {
+			if (bytes.empty() || too_big)
+				return;
+			if (segment_count == 0) {
+				write_keyframe(engine);
+				if (segment_count == 0)
+					return;
+			}
+
+			uint8_t buffer[max_turn_bytes];
+			uint64_t tick = engine.tick_count;
+			size_t length = ReplayFormat::put_varint(buffer, ((tick - segment(segment_count - 1).last_turn_tick) << 2) | ReplayFormat::turn_record(dir));
+
+			Segment* newest = &segment(segment_count - 1);
+			if (newest->offset + newest->size + length > bytes.size()) {
+				write_keyframe(engine); // a fresh segment has room at its end, always
+				if (segment_count == 0)
+					return;
+				newest = &segment(segment_count - 1);
+				length = ReplayFormat::put_varint(buffer, (uint64_t)ReplayFormat::turn_record(dir));
+			}
+			make_room(newest->offset + newest->size, length, 1);
+
+			memcpy(&bytes[newest->offset + newest->size], buffer, length);
+			newest->size += length;
+			newest->last_turn_tick = tick;
+		}
+
+		// puts the engine at tick, which has to be between oldest_tick() and newest_tick(), and leaves the buffer as it is,
+		// for looking around in what was played. to play on from there and record it, rewind() instead
+		template <class Engine>
+		bool seek(Engine& engine, uint64_t tick) const {
+			size_t index = 0, end = 0;
+			uint64_t last_turn_tick = 0;
+			return restore(engine, tick, index, end, last_turn_tick);
+		}
+
+		// seek() and everything after tick is forgotten, the game goes on from there as if it never happened
+		template <class Engine>
+		bool rewind(Engine& engine, uint64_t tick) {
+			size_t index = 0, end = 0;
+			uint64_t last_turn_tick = 0;
+			if (!restore(engine, tick, index, end, last_turn_tick))
+				return false;
+
+			Segment& kept = segment(index);
+			kept.size = end;
+			kept.last_turn_tick = last_turn_tick;
+			segment_count = index + 1;
+			recorded_tick = tick;
+			return true;
+		}
+};
\ No newline at end of file
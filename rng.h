@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// pcg32 (pcg-random.org), a tiny and fast generator that's seeded once and gives the same numbers for the same seed on every machine
+
+class Pcg32 {
+	private:
+		uint64_t state = 0x853c49e6748fea9bULL;
+		uint64_t increment = 0xda3e39cb94b95bdbULL;
+
+	public:
+		Pcg32() {};
+
+		explicit Pcg32(uint64_t seed_value, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+			seed(seed_value, stream);
+		}
+
+		void seed(uint64_t seed_value, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+			state = 0;
+			increment = (stream << 1) | 1;
+			next();
+			state += seed_value;
+			next();
+		}
+
+		uint32_t next() {
+			uint64_t old_state = state;
+			state = old_state * 6364136223846793005ULL + increment;
+			uint32_t xorshifted = (uint32_t)(((old_state >> 18) ^ old_state) >> 27);
+			uint32_t rot = (uint32_t)(old_state >> 59);
+			return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+		}
+
+		// unbiased number in [0, bound) without a division in the common case (lemire's method)
+		uint32_t bounded(uint32_t bound) {
+			uint64_t product = (uint64_t)next() * bound;
+			uint32_t low = (uint32_t)product;
+
+			if (low < bound) {
+				uint32_t threshold = (0u - bound) % bound;
+				while (low < threshold) {
+					product = (uint64_t)next() * bound;
+					low = (uint32_t)product;
+				}
+			}
+			return (uint32_t)(product >> 32);
+		}
+
+		// inclusive on both ends like std::uniform_int_distribution
+		int range(int range_begin, int range_end) {
+			return range_begin + (int)bounded((uint32_t)(range_end - range_begin) + 1);
+		}
+};
\ No newline at end of file
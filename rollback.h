@@ -0,0 +1,380 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "versus.h"
+#include "replay.h"
+
+// rollback netcode for VersusEngine. every peer runs the whole game itself and nobody waits for anyone's inputs: the
+// frame goes ahead with the local input and a guess for everybody else's (no turn, which is right almost every frame).
+// when a remote input turns out to be something else the engine goes back to a copy from before that frame and plays
+// the frames up to now again with the real inputs, so a remote turn shows up late by the network delay but the local
+// player never waits for the network. only when a peer hasn't been heard of for max_rollback frames does the game stall.
+//
+// the packets only carry inputs that changed, since the game's input is "no turn" nearly every frame. every packet
+// tells the peer "my inputs are final up to frame up_to, and these are the turns in it since the last frame you told me
+// you have". packets go out when the local player turns and every idle_send_frames otherwise, and anything not acked
+// yet is in every packet, so a lost packet is made up for by the next one. once a second a peer also sends a checksum
+// of the game at a frame everybody's inputs are final for, if those ever differ the peers went out of sync.
+//
+// a packet, every number a varint (see replay.h):
+//   u8 sender player (low 3 bits) and whether there's a checksum (bit 3)
+//   up_to, up_to - from, the frame the sender has the receiver's inputs up to (the ack), how many turns follow
+//   per turn: ((frame - previous turn's frame, or from) << 2) | (direction - up)
+//   with a checksum: up_to - its frame, then the checksum as 4 little endian bytes
+// an idle packet is about 8 bytes, so a player sends a few dozen bytes a second to each peer
+
+struct RollbackStats {
+	unsigned long long packets_sent = 0;
+	unsigned long long bytes_sent = 0;
+	unsigned long long packets_received = 0;
+	unsigned long long bytes_received = 0;
+	unsigned long long bad_packets = 0;
+	unsigned long long rollbacks = 0;
+	unsigned long long frames_resimulated = 0;
+	unsigned long long longest_rollback = 0;
+	unsigned long long stalls = 0; // advance() calls that had to wait for a peer
+	unsigned long long frames_held = 0; // frames waited out to let a peer that's behind catch up
+	unsigned long long checksums_matched = 0;
+	unsigned long long desyncs = 0;
+	uint64_t first_desync_frame = 0;
+};
+
+class RollbackSession {
+	public:
+		typedef VersusEngine::Input Input;
+
+		static const uint64_t max_rollback = 40; // frames, 800 ms. a peer this far behind makes the game stall
+		static const uint64_t input_history = 128; // frames of inputs kept, enough to resend everything a peer hasn't acked
+		static const uint64_t idle_send_frames = 10; // a packet every 200 ms when nothing happens
+		static const uint64_t checksum_interval = 50; // once a second
+		static const size_t max_turns_per_packet = 48;
+		static const size_t max_packet_size = 16 + max_turns_per_packet * 2 + 16;
+
+	private:
+		static const int max_players = VersusEngine::max_players;
+		static const size_t checksum_history = 4;
+
+		struct Checksum {
+			uint64_t frame = ~0ULL;
+			uint32_t value = 0;
+		};
+
+		int players = 0;
+		int local = 0;
+		VersusEngine state; // the game at frame current, with guessed inputs
+		std::vector<VersusEngine> snapshots; // the game right before frame f is at f % snapshots.size()
+
+		Input inputs[max_players][input_history] = {}; // the real input, or the guess for frames the player isn't confirmed for
+		uint64_t confirmed[max_players] = {}; // the player's inputs are final for every frame before this
+		uint64_t acked[max_players] = {}; // the peer has the local inputs for every frame before this
+		uint64_t last_sent[max_players] = {}; // frame the last packet to the peer went out on
+		bool send_now[max_players] = {};
+		bool send_checksum[max_players] = {};
+		int64_t hold[max_players] = {}; // frames to wait out so the peer can catch up
+		uint64_t rollback_from = ~0ULL; // oldest frame a late input changed, ~0 if none
+
+		uint64_t next_checksum_frame = 0;
+		Checksum local_checksums[checksum_history];
+		Checksum remote_checksums[max_players]; // one that came in before the local one for its frame was made
+		Checksum outgoing_checksum;
+
+		uint64_t oldest_confirmed() const {
+			uint64_t oldest = ~0ULL;
+			for (int p = 0; p < players; p++) {
+				if (confirmed[p] < oldest)
+					oldest = confirmed[p];
+			}
+			return oldest;
+		}
+
+		void step_frame(uint64_t frame) {
+			Input frame_inputs[max_players];
+			for (int p = 0; p < players; p++)
+				frame_inputs[p] = inputs[p][frame % input_history];
+
+			snapshots[frame % snapshots.size()] = state; // same sized copy, nothing allocates
+			state.step(frame_inputs);
+		}
+
+		// goes back to before the oldest wrong guess and plays up to now again
+		void resimulate() {
+			if (rollback_from >= current)
+				return;
+
+			uint64_t depth = current - rollback_from;
+			stats.rollbacks++;
+			stats.frames_resimulated += depth;
+			if (depth > stats.longest_rollback)
+				stats.longest_rollback = depth;
+
+			state = snapshots[rollback_from % snapshots.size()];
+			for (uint64_t frame = rollback_from; frame < current; frame++)
+				step_frame(frame);
+			rollback_from = ~0ULL;
+		}
+
+		void compare_checksums(int peer, const Checksum& remote) {
+			for (const Checksum& mine : local_checksums) {
+				if (mine.frame != remote.frame)
+					continue;
+				if (mine.value == remote.value)
+					stats.checksums_matched++;
+				else {
+					if (stats.desyncs == 0)
+						stats.first_desync_frame = remote.frame;
+					stats.desyncs++;
+				}
+				return;
+			}
+			if (remote.frame >= next_checksum_frame)
+				remote_checksums[peer] = remote; // not there yet ourselves
+		}
+
+		// checksums every frame that's final now, the snapshot from right before it is the game at that frame
+		void make_checksums() {
+			uint64_t final_before = oldest_confirmed();
+			while (next_checksum_frame <= final_before && next_checksum_frame < current) {
+				if (current - next_checksum_frame <= snapshots.size()) {
+					Checksum checksum;
+					checksum.frame = next_checksum_frame;
+					checksum.value = snapshots[next_checksum_frame % snapshots.size()].checksum();
+					local_checksums[(next_checksum_frame / checksum_interval) % checksum_history] = checksum;
+					outgoing_checksum = checksum;
+
+					for (int p = 0; p < players; p++) {
+						if (p == local)
+							continue;
+						send_checksum[p] = true;
+						if (remote_checksums[p].frame == checksum.frame) {
+							compare_checksums(p, remote_checksums[p]);
+							remote_checksums[p] = Checksum();
+						}
+					}
+				}
+				next_checksum_frame += checksum_interval;
+			}
+		}
+
+	public:
+		uint64_t current = 0; // the next frame to play
+		RollbackStats stats;
+
+		RollbackSession() {};
+
+		// every peer has to start with the same board, player count and seed
+		void start(int player_count, int local_player, int width, int height, uint64_t seed) {
+			players = player_count;
+			local = local_player;
+			state.reset(width, height, players, seed);
+			snapshots.assign(max_rollback + 1, state);
+
+			memset(inputs, 0, sizeof(inputs));
+			for (int p = 0; p < max_players; p++) {
+				confirmed[p] = 0;
+				acked[p] = 0;
+				last_sent[p] = 0;
+				send_now[p] = true; // say hello right away
+				send_checksum[p] = false;
+				hold[p] = 0;
+				remote_checksums[p] = Checksum();
+			}
+			for (Checksum& checksum : local_checksums)
+				checksum = Checksum();
+
+			current = 0;
+			rollback_from = ~0ULL;
+			next_checksum_frame = checksum_interval;
+			stats = RollbackStats();
+		}
+
+		const VersusEngine& engine() const {
+			return state;
+		}
+
+		int player_count() const {
+			return players;
+		}
+
+		int local_player() const {
+			return local;
+		}
+
+		// plays the next frame with the local player's input, false if a peer is too far behind and the game has to wait
+		bool advance(Input local_input) {
+			for (int p = 0; p < players; p++) {
+				if (p != local && (current >= confirmed[p] + max_rollback || current + 1 >= acked[p] + input_history)) {
+					stats.stalls++;
+					return false;
+				}
+			}
+
+			uint64_t slot = current % input_history;
+			for (int p = 0; p < players; p++) {
+				if (p == local)
+					inputs[p][slot] = local_input;
+				else if (confirmed[p] <= current)
+					inputs[p][slot] = VersusEngine::no_input; // the guess
+			}
+			confirmed[local] = current + 1;
+
+			if (local_input != VersusEngine::no_input) {
+				for (int p = 0; p < players; p++)
+					send_now[p] = p != local;
+			}
+
+			resimulate();
+			step_frame(current);
+			current++;
+			make_checksums();
+			return true;
+		}
+
+		// true if this frame should be waited out because the peers are behind, the frame after that is played as usual
+		bool should_hold() {
+			int64_t most = 0;
+			for (int p = 0; p < players; p++) {
+				if (hold[p] > most)
+					most = hold[p];
+			}
+			if (most < 2)
+				return false; // a frame either way is just the packets' timing
+
+			for (int p = 0; p < players; p++) {
+				if (hold[p] > 0)
+					hold[p]--;
+			}
+			stats.frames_held++;
+			return true;
+		}
+
+		bool wants_to_send(int peer) const {
+			return peer != local && (send_now[peer] || current >= last_sent[peer] + idle_send_frames);
+		}
+
+		// out needs room for max_packet_size bytes, returns how many were written
+		size_t write_packet(int peer, uint8_t* out) {
+			uint64_t from = acked[peer];
+			uint64_t up_to = confirmed[local];
+
+			// too many turns for one packet only happens after a long outage, the rest goes in the next one
+			size_t turns = 0;
+			for (uint64_t frame = from; frame < up_to; frame++) {
+				if (inputs[local][frame % input_history] == VersusEngine::no_input)
+					continue;
+				if (turns == max_turns_per_packet) {
+					up_to = frame;
+					break;
+				}
+				turns++;
+			}
+
+			bool with_checksum = send_checksum[peer] && outgoing_checksum.frame <= up_to;
+			size_t size = 0;
+			out[size++] = (uint8_t)(local | (with_checksum ? 8 : 0));
+			size += ReplayFormat::put_varint(out + size, up_to);
+			size += ReplayFormat::put_varint(out + size, up_to - from);
+			size += ReplayFormat::put_varint(out + size, confirmed[peer]);
+			size += ReplayFormat::put_varint(out + size, turns);
+
+			uint64_t previous = from;
+			for (uint64_t frame = from; frame < up_to; frame++) {
+				Input input = inputs[local][frame % input_history];
+				if (input == VersusEngine::no_input)
+					continue;
+				size += ReplayFormat::put_varint(out + size, ((frame - previous) << 2) | (uint64_t)(input - (Input)NodeDirection::UP));
+				previous = frame;
+			}
+
+			if (with_checksum) {
+				size += ReplayFormat::put_varint(out + size, up_to - outgoing_checksum.frame);
+				for (int i = 0; i < 4; i++)
+					out[size++] = (uint8_t)(outgoing_checksum.value >> (i * 8));
+				send_checksum[peer] = false;
+			}
+
+			last_sent[peer] = current;
+			send_now[peer] = false;
+			stats.packets_sent++;
+			stats.bytes_sent += size;
+			return size;
+		}
+
+		// takes a packet from a peer in, false if it isn't one. late inputs are played again on the next advance()
+		bool read_packet(const uint8_t* data, size_t size) {
+			uint64_t up_to = 0, span = 0, ack = 0, turns = 0;
+			size_t offset = 1;
+			int sender = size > 0 ? data[0] & 7 : -1;
+			bool with_checksum = size > 0 && (data[0] & 8) != 0;
+
+			if (size == 0 || sender >= players || sender == local || !ReplayFormat::get_varint(data, size, offset, up_to) || !ReplayFormat::get_varint(data, size, offset, span)
+				|| !ReplayFormat::get_varint(data, size, offset, ack) || !ReplayFormat::get_varint(data, size, offset, turns) || span > up_to || turns > max_turns_per_packet) {
+				stats.bad_packets++;
+				return false;
+			}
+
+			uint64_t turn_frames[max_turns_per_packet];
+			Input turn_inputs[max_turns_per_packet];
+			uint64_t frame = up_to - span;
+			for (uint64_t i = 0; i < turns; i++) {
+				uint64_t record = 0;
+				if (!ReplayFormat::get_varint(data, size, offset, record) || (record >> 2) > up_to - frame) {
+					stats.bad_packets++;
+					return false;
+				}
+				frame += record >> 2;
+				turn_frames[i] = frame;
+				turn_inputs[i] = (Input)((int)NodeDirection::UP + (int)(record & 3));
+			}
+
+			Checksum checksum;
+			if (with_checksum) {
+				uint64_t back = 0;
+				if (!ReplayFormat::get_varint(data, size, offset, back) || back > up_to || size - offset < 4) {
+					stats.bad_packets++;
+					return false;
+				}
+				checksum.frame = up_to - back;
+				checksum.value = 0;
+				for (int i = 0; i < 4; i++)
+					checksum.value |= (uint32_t)data[offset++] << (i * 8);
+			}
+
+			stats.packets_received++;
+			stats.bytes_received += size;
+
+			if (ack > acked[sender] && ack <= confirmed[local])
+				acked[sender] = ack;
+
+			// the sender's inputs from where we are with it up to up_to. packets that are older than what we have, or that
+			// would need inputs we never got (which can't happen while every unacked turn is resent), change nothing
+			uint64_t first = confirmed[sender];
+			if (up_to > first && up_to - span <= first && up_to + max_rollback < current + input_history) {
+				size_t next_turn = 0;
+				while (next_turn < turns && turn_frames[next_turn] < first)
+					next_turn++;
+
+				for (uint64_t f = first; f < up_to; f++) {
+					Input input = VersusEngine::no_input;
+					if (next_turn < turns && turn_frames[next_turn] == f)
+						input = turn_inputs[next_turn++];
+
+					Input& known = inputs[sender][f % input_history];
+					if (f < current && known != input && f < rollback_from)
+						rollback_from = f; // guessed wrong
+					known = input;
+				}
+				confirmed[sender] = up_to;
+			}
+
+			// both sides are behind each other by the network delay, the one that's further ahead than that waits a bit
+			int64_t local_advantage = (int64_t)current - (int64_t)up_to;
+			int64_t remote_advantage = (int64_t)up_to - (int64_t)ack;
+			hold[sender] = (local_advantage - remote_advantage) / 2;
+
+			if (with_checksum)
+				compare_checksums(sender, checksum);
+			return true;
+		}
+};
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
-#include "sprite.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 enum class NodeDirection {
 	DUMMY_VALUE,
@@ -9,30 +11,91 @@ enum class NodeDirection {
 	RIGHT
 };
 
-class SnekNode {
+// the way back the snek came from, DUMMY_VALUE for anything that isn't a direction
+inline NodeDirection opposite(NodeDirection dir) {
+	switch (dir) {
+		case NodeDirection::UP:
+			return NodeDirection::DOWN;
+		case NodeDirection::DOWN:
+			return NodeDirection::UP;
+		case NodeDirection::LEFT:
+			return NodeDirection::RIGHT;
+		case NodeDirection::RIGHT:
+			return NodeDirection::LEFT;
+		default:
+			return NodeDirection::DUMMY_VALUE;
+	}
+}
+
+// a board cell packed into a single number (y * board width + x)
+typedef uint32_t Cell;
+
+// the snek's body as a circular buffer of cells, index 0 is the head and size() - 1 is the tail.
+// the buffer is allocated once for the longest possible snek, so moving and growing never copy or allocate anything
+
+class SnekBody {
+	private:
+		std::vector<Cell> cells;
+		size_t head_index = 0;
+		size_t length = 0;
+
 	public:
-		Sprite node_sprite;
-
-		SnekNode() {};
-
-		SnekNode(const char *path, SDL_Renderer *renderer, std::vector<SDL_Texture*> &texture_container, int startx, int starty) {
-			node_sprite = { path, renderer, texture_container, startx, starty };
-		}
-
-		void move(NodeDirection dir) {
-			switch (dir) {
-				case NodeDirection::UP:
-					node_sprite.rect.y -= 50;
-					break;
-				case NodeDirection::DOWN:
-					node_sprite.rect.y += 50;
-					break;
-				case NodeDirection::LEFT:
-					node_sprite.rect.x -= 50;
-					break;
-				case NodeDirection::RIGHT:
-					node_sprite.rect.x += 50;
-					break;
-			}
+		SnekBody() {};
+
+		// sizes the buffer for a snek that fills the whole board and puts a single head on start_cell
+		void reset(size_t capacity, Cell start_cell) {
+			if (cells.size() != capacity)
+				cells.assign(capacity, 0);
+
+			head_index = 0;
+			length = 1;
+			cells[head_index] = start_cell;
+		}
+
+		size_t size() const {
+			return length;
+		}
+
+		size_t capacity() const {
+			return cells.size();
+		}
+
+		bool full() const {
+			return length == cells.size();
+		}
+
+		// i-th segment counting from the head
+		Cell at(size_t i) const {
+			size_t index = head_index + i;
+			if (index >= cells.size())
+				index -= cells.size();
+			return cells[index];
+		}
+
+		Cell head() const {
+			return cells[head_index];
+		}
+
+		Cell tail() const {
+			return at(length - 1);
+		}
+
+		// a move is a new head plus dropping the tail, growing is adding a segment behind the tail
+		void push_head(Cell cell) {
+			head_index = (head_index == 0 ? cells.size() : head_index) - 1;
+			cells[head_index] = cell;
+			length++;
+		}
+
+		void pop_tail() {
+			length--;
+		}
+
+		void push_tail(Cell cell) {
+			length++;
+			size_t index = head_index + length - 1;
+			if (index >= cells.size())
+				index -= cells.size();
+			cells[index] = cell;
 		}
 };
\ No newline at end of file
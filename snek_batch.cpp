@@ -0,0 +1,46 @@
+#define SNEK_BATCH_BUILD
+#include "snek_batch.h"
+#include "batch_env.h"
+
+// the c interface in snek_batch.h, a thin wrapper that only forwards to BatchEnv
+
+struct SnekBatch {
+	BatchEnv env;
+	uint8_t* observations = nullptr;
+};
+
+SnekBatch* snek_batch_create(size_t env_count, int width, int height, uint64_t seed, uint8_t* observations) {
+	SnekBatch* batch = new SnekBatch();
+	if (!batch->env.reset(env_count, width, height, seed, observations)) {
+		delete batch;
+		return nullptr;
+	}
+	batch->observations = observations;
+	return batch;
+}
+
+void snek_batch_destroy(SnekBatch* batch) {
+	delete batch;
+}
+
+void snek_batch_reset(SnekBatch* batch, uint64_t seed) {
+	uint32_t hunger_limit = batch->env.hunger_limit;
+	batch->env.reset(batch->env.env_count, batch->env.board_width, batch->env.board_height, seed, batch->observations);
+	batch->env.hunger_limit = hunger_limit;
+}
+
+void snek_batch_step(SnekBatch* batch, const uint8_t* actions, float* rewards, uint8_t* dones) {
+	batch->env.step(actions, rewards, dones);
+}
+
+void snek_batch_set_hunger_limit(SnekBatch* batch, uint32_t moves) {
+	batch->env.hunger_limit = moves;
+}
+
+const uint32_t* snek_batch_scores(const SnekBatch* batch) {
+	return batch->env.score.data();
+}
+
+const uint32_t* snek_batch_final_scores(const SnekBatch* batch) {
+	return batch->env.final_score.data();
+}
\ No newline at end of file
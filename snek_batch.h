@@ -0,0 +1,44 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* a c interface to BatchEnv (batch_env.h), so training code in other languages can load it as a shared library,
+   e.g. from python with ctypes and numpy arrays as the buffers. everything is stepped in place: the observations go
+   into the buffer given to snek_batch_create() and actions, rewards and dones are arrays with an entry per environment */
+
+#if defined(_WIN32) && defined(SNEK_BATCH_BUILD)
+#define SNEK_BATCH_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define SNEK_BATCH_API __declspec(dllimport)
+#else
+#define SNEK_BATCH_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SnekBatch SnekBatch;
+
+/* observations needs env_count * width * height bytes and has to stay around until snek_batch_destroy(). a cell is
+   0 empty, 1 snek, 2 the snek's head or 3 food. null if the board is smaller than 2x2 or has more than 65536 cells */
+SNEK_BATCH_API SnekBatch* snek_batch_create(size_t env_count, int width, int height, uint64_t seed, uint8_t* observations);
+SNEK_BATCH_API void snek_batch_destroy(SnekBatch* batch);
+
+/* every environment starts a new game */
+SNEK_BATCH_API void snek_batch_reset(SnekBatch* batch, uint64_t seed);
+
+/* an action is 0 to keep going or 1 up, 2 down, 3 left, 4 right. the reward is 1 for food, -1 for dying and 0 otherwise.
+   environments whose game ended start over right away, done is 1 for them and their observation is the new game's */
+SNEK_BATCH_API void snek_batch_step(SnekBatch* batch, const uint8_t* actions, float* rewards, uint8_t* dones);
+
+/* moves without food after which a game counts as lost, 0 (the default) for never */
+SNEK_BATCH_API void snek_batch_set_hunger_limit(SnekBatch* batch, uint32_t moves);
+
+/* per environment, the score of the game being played and of the last one that ended */
+SNEK_BATCH_API const uint32_t* snek_batch_scores(const SnekBatch* batch);
+SNEK_BATCH_API const uint32_t* snek_batch_final_scores(const SnekBatch* batch);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include <SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "alloc_counter.h"
+#include "game.h"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// plays the real game offscreen for hours of simulation time with scripted input: the menu (left alone long enough
+// for the demo now and then), the instructions, a game the autopilot plays until the script starts steering it into
+// itself, the game over screen, a rewind now and then and the next game. every so often it samples resident memory,
+// live textures, live allocations and the time a tick and a frame take, and at the end it fits a line through the
+// samples after the warm up. anything that keeps growing fails the run with exit code 1, e.g.
+// "snek_soak --ticks 10000000" is about 14 hours of play
+
+struct SoakSample {
+	double tick = 0;
+	double rss_kb = 0;
+	double textures = 0;
+	double texture_kb = 0;
+	double live_allocations = 0;
+	double tick_us = 0; // mean over the ticks since the sample before
+	double frame_us = 0;
+};
+
+// how much a metric grew from the first sample to the last by a least squares line, so a single spike doesn't count
+static double fitted_growth(const std::vector<SoakSample>& samples, size_t first, double SoakSample::* metric) {
+	double n = (double)(samples.size() - first);
+	double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+	for (size_t i = first; i < samples.size(); i++) {
+		double x = samples[i].tick, y = samples[i].*metric;
+		sum_x += x;
+		sum_y += y;
+		sum_xx += x * x;
+		sum_xy += x * y;
+	}
+	double denominator = n * sum_xx - sum_x * sum_x;
+	if (n < 2 || denominator == 0)
+		return 0;
+	double slope = (n * sum_xy - sum_x * sum_y) / denominator;
+	return slope * (samples.back().tick - samples[first].tick);
+}
+
+// the median of the last quarter of the samples minus the median of the first quarter, for the timings which jump
+// around with whatever else the machine was doing
+static double median_growth(const std::vector<SoakSample>& samples, size_t first, double SoakSample::* metric) {
+	size_t quarter = (samples.size() - first) / 4;
+	if (quarter == 0)
+		return 0;
+
+	auto median = [&](size_t from) {
+		std::vector<double> values;
+		for (size_t i = from; i < from + quarter; i++)
+			values.push_back(samples[i].*metric);
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	};
+	return median(samples.size() - quarter) - median(first);
+}
+
+static double mean(const std::vector<SoakSample>& samples, size_t first, double SoakSample::* metric) {
+	double sum = 0;
+	for (size_t i = first; i < samples.size(); i++)
+		sum += samples[i].*metric;
+	return samples.size() > first ? sum / (samples.size() - first) : 0;
+}
+
+// 0 where there's no /proc to ask
+static double resident_kb() {
+#ifdef __linux__
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm == nullptr)
+		return 0;
+	unsigned long long pages = 0, resident = 0;
+	int read = fscanf(statm, "%llu %llu", &pages, &resident);
+	fclose(statm);
+	return read == 2 ? (double)resident * sysconf(_SC_PAGESIZE) / 1024 : 0;
+#else
+	return 0;
+#endif
+}
+
+// what a player would do next, one key (or click) at a time
+class SoakScript {
+	private:
+		Pcg32 rng;
+		GameState state = GameState::GAME_LOADING;
+		uint64_t next_action = 0; // tick
+		uint64_t game_started = 0;
+
+		void press(Game& game, SDL_Keycode key) {
+			InputCommand input;
+			input.key = key;
+			game.apply_input(input);
+		}
+
+		void wait(uint64_t now, uint32_t min_ms, uint32_t max_ms) {
+			next_action = now + (min_ms + rng.bounded(max_ms - min_ms + 1)) / SnekEngine::tick_interval;
+		}
+
+	public:
+		uint32_t autopilot_ms = 60000; // how long the autopilot gets to play a game before the script steers it into itself
+		unsigned long long games = 0;
+		unsigned long long rewinds = 0;
+
+		explicit SoakScript(uint64_t seed) : rng(seed, 0x50a6) {}
+
+		// right before the game's tick with this number
+		void step(Game& game, uint64_t tick) {
+			if (game.game_state != state) { // how long to look at a screen before doing something, the menu sometimes long enough for the demo
+				state = game.game_state;
+				if (state == GameState::GAME_MENU)
+					wait(tick, 500, 15000);
+				else if (state == GameState::GAME_INSTRUCTIONS)
+					wait(tick, 500, 3000);
+				else if (state == GameState::GAME_END)
+					wait(tick, 1000, 4000);
+				game_started = tick;
+			}
+
+			switch (state) {
+				case GameState::GAME_MENU:
+					if (tick < next_action)
+						break;
+					if (rng.bounded(4) == 0) { // the sound buttons
+						InputCommand input;
+						input.type = InputCommand::CLICK;
+						input.x = game.sound_on_sprite.rect.x + game.sound_on_sprite.rect.w / 2;
+						input.y = game.sound_on_sprite.rect.y + game.sound_on_sprite.rect.h / 2;
+						game.apply_input(input);
+						wait(tick, 200, 2000);
+					}
+					else
+						press(game, SDLK_SPACE);
+					break;
+				case GameState::GAME_INSTRUCTIONS:
+					if (tick >= next_action) {
+						press(game, SDLK_RETURN);
+						games++;
+					}
+					break;
+				case GameState::GAME_ACTIVE:
+					if (game.attract_mode) {
+						if (rng.bounded(20000) == 0)
+							press(game, SDLK_SPACE); // ends the demo, back to the menu
+						break;
+					}
+					game.autopilot_on = (tick - game_started) * SnekEngine::tick_interval < autopilot_ms;
+					if (!game.autopilot_on && rng.bounded(20) == 0) {
+						const SDL_Keycode keys[] = { SDLK_UP, SDLK_DOWN, SDLK_LEFT, SDLK_RIGHT };
+						press(game, keys[rng.bounded(4)]);
+					}
+					else if (rng.bounded(30000) == 0)
+						press(game, SDLK_m);
+					break;
+				case GameState::GAME_END:
+					if (tick < next_action)
+						break;
+					if (rng.bounded(5) == 0) {
+						press(game, SDLK_BACKSPACE); // back to a second before, and the autopilot takes over again
+						rewinds++;
+					}
+					else {
+						press(game, SDLK_RETURN);
+						games++;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+};
+
+int main(int argc, char* argv[]) {
+	uint64_t ticks = 1000000;
+	int sample_count = 100;
+	int frame_ticks = 3; // a frame every 15 ms of simulation, about what the real loop draws
+	double warm_up = 0.2; // share of the samples left out of the trends
+	double rss_slack_kb = 2048;
+	double allocation_slack = 1000;
+	double slowdown = 0.25; // how much slower the ticks or frames may get by the end
+	GameOptions options;
+	options.offscreen = true;
+	options.has_seed = true;
+	options.seed = 1;
+	options.record_path = nullptr;
+	options.autopilot_budget_us = 0; // the same moves on every machine
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+			ticks = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+			sample_count = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			options.seed = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &options.board_width, &options.board_height) != 2 || options.board_width < 2 || options.board_height < 2) {
+				std::cerr << "--board expects WIDTHxHEIGHT, e.g. 20x15" << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--rss-slack") == 0 && i + 1 < argc)
+			rss_slack_kb = atof(argv[++i]);
+		else if (strcmp(argv[i], "--slowdown") == 0 && i + 1 < argc)
+			slowdown = atof(argv[++i]) / 100.0;
+		else {
+			std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+			return 1;
+		}
+	}
+	if (sample_count < 10)
+		sample_count = 10;
+	if (ticks < (uint64_t)sample_count)
+		ticks = sample_count;
+
+	Game game(options);
+	game.finish_loading();
+	if (game.game_state != GameState::GAME_MENU) {
+		std::cerr << "couldn't start the game offscreen" << std::endl;
+		return 1;
+	}
+	game.redraw.start();
+	game.pacer.start();
+
+	SoakScript script(options.seed);
+	std::vector<SoakSample> samples;
+	samples.reserve(sample_count + 1);
+	uint64_t sample_every = ticks / sample_count > 0 ? ticks / sample_count : 1;
+	double tick_seconds = 0, frame_seconds = 0;
+	unsigned long long frames = 0;
+	auto started = std::chrono::steady_clock::now();
+
+	printf("%12s %10s %9s %11s %12s %9s %9s %7s\n", "tick", "rss_kb", "textures", "texture_kb", "live_allocs", "tick_us", "frame_us", "games");
+	for (uint64_t tick = 0; tick < ticks && game.game_state != GameState::GAME_QUIT; tick++) {
+		script.step(game, tick);
+
+		auto before = std::chrono::steady_clock::now();
+		game.tick();
+		auto after = std::chrono::steady_clock::now();
+		tick_seconds += std::chrono::duration<double>(after - before).count();
+
+		if (tick % frame_ticks == 0)
+			game.handle_events();
+		if (tick % frame_ticks == 0 && game.redraw.should_draw()) {
+			game.update();
+			game.render();
+			game.redraw.presented();
+			if (game.sliding && game.game_state == GameState::GAME_ACTIVE)
+				game.redraw.invalidate();
+			frame_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - after).count();
+			frames++;
+		}
+
+		if ((tick + 1) % sample_every == 0) {
+			SoakSample sample;
+			sample.tick = (double)(tick + 1);
+			sample.rss_kb = resident_kb();
+			sample.textures = (double)game.textures.texture_count();
+			sample.texture_kb = game.textures.texture_bytes() / 1024.0;
+			sample.live_allocations = (double)(allocation_count() - deallocation_count());
+			sample.tick_us = tick_seconds * 1e6 / sample_every;
+			sample.frame_us = frames > 0 ? frame_seconds * 1e6 / frames : 0;
+			samples.push_back(sample);
+			tick_seconds = frame_seconds = 0;
+			frames = 0;
+
+			printf("%12.0f %10.0f %9.0f %11.1f %12.0f %9.3f %9.1f %7llu\n", sample.tick, sample.rss_kb, sample.textures, sample.texture_kb,
+				sample.live_allocations, sample.tick_us, sample.frame_us, script.games);
+			fflush(stdout);
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+	std::cout << "played " << samples.back().tick * SnekEngine::tick_interval / 3600000.0 << " h of simulation in " << seconds << " s: "
+		<< script.games << " games, " << script.rewinds << " rewinds" << std::endl;
+
+	// the growth of every metric after the warm up, against how much it may grow
+	size_t first = (size_t)(samples.size() * warm_up);
+	struct Check {
+		const char* name;
+		double SoakSample::* metric;
+		double allowed;
+		bool timing;
+	};
+	const Check checks[] = {
+		{ "resident memory (KB)", &SoakSample::rss_kb, rss_slack_kb, false },
+		{ "live textures", &SoakSample::textures, 0.5, false },
+		{ "texture memory (KB)", &SoakSample::texture_kb, 1.0, false },
+		{ "live allocations", &SoakSample::live_allocations, allocation_slack, false },
+		{ "tick time (us)", &SoakSample::tick_us, mean(samples, first, &SoakSample::tick_us) * slowdown, true },
+		{ "frame time (us)", &SoakSample::frame_us, mean(samples, first, &SoakSample::frame_us) * slowdown, true }
+	};
+
+	bool grew = false;
+	for (const Check& check : checks) {
+		double growth = check.timing ? median_growth(samples, first, check.metric) : fitted_growth(samples, first, check.metric);
+		bool failed = growth > check.allowed;
+		grew |= failed;
+		printf("%-22s mean %12.3f, grew %12.3f over the run (%s %.3f)\n", check.name, mean(samples, first, check.metric), growth,
+			failed ? "FAILED, allowed" : "allowed", check.allowed);
+	}
+
+	size_t leaked = game.release_textures(); // before shutdown() frees whatever is left no matter who holds it
+	if (leaked > 0) {
+		std::cerr << leaked << " textures still alive after the game let go of all of its own" << std::endl;
+		grew = true;
+	}
+	game.shutdown();
+	return grew ? 1 : 0;
+}
\ No newline at end of file
@@ -3,39 +3,28 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <vector>
+#include "texture_cache.h"
 
 // a container class made for automatically getting the width and height of an image and setting its starting coordinates on initialization
 
 class Sprite {
     public:
         SDL_Rect rect = {0, 0, 0, 0};
-        SDL_Texture* texture = nullptr;
+        TextureHandle texture;
 
         Sprite() {};
 
-        Sprite(const char* path, SDL_Renderer *renderer, std::vector<SDL_Texture*> &texture_container, int start_pos_x, int start_pos_y) {
-            if (texture != nullptr) {
-                SDL_DestroyTexture(texture);
-                texture = nullptr;
-            }
+        Sprite(const char* path, SDL_Renderer *renderer, TextureCache &texture_cache, int start_pos_x, int start_pos_y) {
+            SNEK_PROFILE_ZONE("Sprite::Sprite");
+            texture = texture_cache.load(renderer, path);
 
-            texture = IMG_LoadTexture(renderer, path);
-
-            if (texture == NULL)
-                std::cerr << "failed to load texture \"" << path << "\", error: " << IMG_GetError() << std::endl;
-
-            texture_container.emplace_back(texture);
-            SDL_QueryTexture(texture, NULL, NULL, &rect.w, &rect.h); // fill rect.w and rect.h with the width and height of the loaded image
+            SDL_QueryTexture(texture.get(), NULL, NULL, &rect.w, &rect.h); // fill rect.w and rect.h with the width and height of the loaded image
             rect.x = start_pos_x;
             rect.y = start_pos_y;
         }
 
-        void swap_textures(const char* new_texture_path, SDL_Renderer *renderer, std::vector<SDL_Texture*> texture_container) {
-            SDL_DestroyTexture(texture);
-            texture = nullptr;
-
-            texture = IMG_LoadTexture(renderer, new_texture_path);
-            texture_container.emplace_back(texture);
-            SDL_QueryTexture(texture, NULL, NULL, &rect.w, &rect.h);
+        void swap_textures(const char* new_texture_path, SDL_Renderer *renderer, TextureCache &texture_cache) {
+            texture = texture_cache.load(renderer, new_texture_path); // the old texture is freed once nobody else uses it
+            SDL_QueryTexture(texture.get(), NULL, NULL, &rect.w, &rect.h);
         }
 };
\ No newline at end of file
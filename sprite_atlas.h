@@ -0,0 +1,170 @@
+#pragma once
+#include <iostream>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <vector>
+#include "texture_cache.h"
+#include "profiler.h"
+
+// packs a bunch of images into one texture at startup, so everything on the board can come from a single texture
+// and be drawn with a single SDL_RenderGeometry call (needs SDL 2.0.18 or newer)
+
+class SpriteAtlas {
+	public:
+		TextureHandle texture;
+		int width = 0;
+		int height = 0;
+		std::vector<SDL_Rect> regions; // where each image ended up, in the order they were given to build()
+
+		SpriteAtlas() {};
+
+		bool build(SDL_Renderer* renderer, TextureCache& texture_cache, const std::vector<const char*>& paths, int max_width = 2048) {
+			SNEK_PROFILE_ZONE("SpriteAtlas::build");
+			std::vector<SDL_Surface*> images(paths.size(), nullptr);
+
+			for (size_t i = 0; i < paths.size(); i++) {
+				SDL_Surface* loaded = IMG_Load(paths[i]);
+				if (loaded == NULL) {
+					std::cerr << "failed to load image \"" << paths[i] << "\", error: " << IMG_GetError() << std::endl;
+					continue;
+				}
+				images[i] = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+				SDL_FreeSurface(loaded);
+			}
+			return build_from_images(renderer, texture_cache, images, max_width);
+		}
+
+		// the same out of images that are already decoded to RGBA32 (null for ones that failed), frees every one of them
+		bool build_from_images(SDL_Renderer* renderer, TextureCache& texture_cache, std::vector<SDL_Surface*>& images, int max_width = 2048) {
+			SNEK_PROFILE_ZONE("SpriteAtlas::build_from_images");
+			const int padding = 1; // keeps filtering from bleeding neighbouring images into each other
+			regions.assign(images.size(), SDL_Rect { 0, 0, 0, 0 });
+
+			for (SDL_Surface* image : images) {
+				if (image != NULL && image->w + padding > max_width)
+					max_width = image->w + padding;
+			}
+
+			// simple shelf packing, tallest images first
+			std::vector<size_t> order(images.size());
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = i;
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+				return (images[a] ? images[a]->h : 0) > (images[b] ? images[b]->h : 0);
+			});
+
+			int x = 0, y = 0, shelf_height = 0;
+			width = height = 0;
+
+			for (size_t i : order) {
+				if (images[i] == NULL)
+					continue;
+
+				if (x + images[i]->w + padding > max_width) {
+					x = 0;
+					y += shelf_height;
+					shelf_height = 0;
+				}
+
+				regions[i] = { x, y, images[i]->w, images[i]->h };
+				x += images[i]->w + padding;
+				shelf_height = std::max(shelf_height, images[i]->h + padding);
+				width = std::max(width, x);
+				height = std::max(height, y + shelf_height);
+			}
+
+			SDL_Surface* sheet = width > 0 && height > 0 ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32) : NULL;
+
+			for (size_t i = 0; i < images.size(); i++) {
+				if (images[i] == NULL)
+					continue;
+
+				if (sheet != NULL) {
+					SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE);
+					SDL_BlitSurface(images[i], NULL, sheet, &regions[i]);
+				}
+				SDL_FreeSurface(images[i]);
+				images[i] = nullptr;
+			}
+
+			if (sheet == NULL) {
+				std::cerr << "failed to create sprite atlas, error: " << SDL_GetError() << std::endl;
+				return false;
+			}
+
+			texture = texture_cache.adopt(SDL_CreateTextureFromSurface(renderer, sheet));
+			SDL_FreeSurface(sheet);
+
+			if (texture == nullptr) {
+				std::cerr << "failed to upload sprite atlas, error: " << SDL_GetError() << std::endl;
+				return false;
+			}
+			SDL_SetTextureBlendMode(texture.get(), SDL_BLENDMODE_BLEND);
+			return true;
+		}
+
+		const SDL_Rect& region(size_t index) const {
+			return regions[index];
+		}
+};
+
+// collects textured quads from one atlas and draws them all at once. the vertex and index buffers only ever grow,
+// so once they're big enough for the longest snek a frame doesn't allocate anything
+
+class SpriteBatch {
+	private:
+		std::vector<SDL_Vertex> vertices;
+		std::vector<int> indices;
+		size_t quads = 0;
+
+	public:
+		SpriteBatch() {};
+
+		void reserve(size_t quad_count) {
+			vertices.reserve(quad_count * 4);
+			grow_indices(quad_count);
+		}
+
+		void begin() {
+			vertices.clear();
+			quads = 0;
+		}
+
+		size_t size() const {
+			return quads;
+		}
+
+		void add(const SpriteAtlas& atlas, const SDL_Rect& src, const SDL_Rect& dst, SDL_Colour colour = { 255, 255, 255, 255 }) {
+			float u0 = (float)src.x / atlas.width, v0 = (float)src.y / atlas.height;
+			float u1 = (float)(src.x + src.w) / atlas.width, v1 = (float)(src.y + src.h) / atlas.height;
+			float x0 = (float)dst.x, y0 = (float)dst.y;
+			float x1 = (float)(dst.x + dst.w), y1 = (float)(dst.y + dst.h);
+
+			vertices.push_back({ { x0, y0 }, colour, { u0, v0 } });
+			vertices.push_back({ { x1, y0 }, colour, { u1, v0 } });
+			vertices.push_back({ { x0, y1 }, colour, { u0, v1 } });
+			vertices.push_back({ { x1, y1 }, colour, { u1, v1 } });
+			quads++;
+		}
+
+		// one draw call for everything added since begin()
+		void submit(SDL_Renderer* renderer, const SpriteAtlas& atlas) {
+			if (quads == 0)
+				return;
+
+			grow_indices(quads);
+			SDL_RenderGeometry(renderer, atlas.texture.get(), vertices.data(), (int)vertices.size(), indices.data(), (int)(quads * 6));
+			SNEK_PROFILE_DRAW_CALLS(1);
+		}
+
+	private:
+		void grow_indices(size_t quad_count) {
+			// every quad is two triangles with the same layout, so the index list only depends on the quad count
+			for (size_t i = indices.size() / 6; i < quad_count; i++) {
+				int base = (int)(i * 4);
+				int quad[] = { base, base + 1, base + 2, base + 2, base + 1, base + 3 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// a fixed size queue between exactly one thread that pushes and one thread that pops, without locks. push() never
+// waits: when the queue is full it says so and the caller decides what to drop. the two indices only ever count up,
+// each is written by one side and read by the other, and they sit on their own cache lines so the sides don't fight over one
+
+template <class T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+
+	private:
+		T items[Capacity];
+		alignas(64) std::atomic<size_t> head { 0 }; // the next item to pop, only the consumer moves it
+		alignas(64) std::atomic<size_t> tail { 0 }; // where the next item goes, only the producer moves it
+
+	public:
+		SpscQueue() {};
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// producer only
+		bool push(const T& item) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == Capacity)
+				return false;
+
+			items[t & (Capacity - 1)] = item;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer only
+		bool pop(T& item) {
+			size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+
+			item = items[h & (Capacity - 1)];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool empty() const {
+			return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+		}
+};
\ No newline at end of file
@@ -4,42 +4,61 @@
 #include <SDL_ttf.h>
 #include <vector>
 #include <string>
+#include "font_cache.h"
 
 // a class that makes creating text less painful albeit with 999999 parameters if you want to change things
+// the glyphs come from a shared atlas, so changing the string or the colour never touches the gpu or the font file
 
 class Text {
 	public:
 		SDL_Rect rect = { 0, 0, 0, 0 };
-		SDL_Texture* texture = nullptr;
+		SDL_Colour colour = { 0, 0, 0, 255 };
+		GlyphAtlas* atlas = nullptr;
+		std::string content;
 
 		Text() {};
 
-		Text (std::string text_to_be_rendered, SDL_Renderer* renderer, std::vector<SDL_Texture*> &texture_container, int start_pos_x = 0, int start_pos_y = 0,
-		int text_size = 24, SDL_Colour text_colour = { 0, 0, 0 },  const char* font_file = "fonts/dogicapixelbold.ttf", int text_width = 69, int text_height = 69) {
+		Text (std::string text_to_be_rendered, SDL_Renderer* renderer, FontCache &font_cache, int start_pos_x = 0, int start_pos_y = 0,
+		int text_size = 24, SDL_Colour text_colour = { 0, 0, 0 },  const char* font_file = "fonts/dogicapixelbold.ttf") {
+			SNEK_PROFILE_ZONE("Text::Text");
+			atlas = font_cache.get(renderer, font_file, text_size);
+			colour = text_colour;
+			colour.a = 255;
 
-			if (texture != nullptr) {
-				SDL_DestroyTexture(texture);
-				texture = nullptr;
+			rect.x = start_pos_x;
+			rect.y = start_pos_y;
+
+			content.reserve(64); // enough for every string in the game, so set_text() doesn't allocate
+			set_text(text_to_be_rendered.c_str());
+		}
+
+		void set_text(const char* new_text) {
+			content.assign(new_text);
+
+			if (atlas != nullptr) {
+				rect.w = atlas->measure(new_text); // set text width and height automatically based on font/size/text
+				rect.h = atlas->line_height;
 			}
+		}
 
-			TTF_Font* font = TTF_OpenFont(font_file, text_size);
-			if (font == NULL)
-				std::cerr << "failed to open font file \"" << font_file << "\", error: " << TTF_GetError() << std::endl;
-			else {
-				TTF_SizeText(font, text_to_be_rendered.c_str(), &text_width, &text_height); // set text width and height automatically based on font/size/text
-				SDL_Surface* text_surface = TTF_RenderText_Solid(font, text_to_be_rendered.c_str(), text_colour);
+		void render(SDL_Renderer* renderer) const {
+			if (atlas == nullptr || atlas->texture == nullptr)
+				return;
 
-				texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-				texture_container.emplace_back(texture);
+			SDL_SetTextureColorMod(atlas->texture.get(), colour.r, colour.g, colour.b);
 
-				rect.x = start_pos_x;
-				rect.y = start_pos_y;
-				rect.w = text_width;
-				rect.h = text_height;
+			int pen_x = rect.x;
+			for (char ch : content) {
+				const Glyph* g = atlas->glyph(ch);
+				if (g == nullptr)
+					continue;
 
-				SDL_FreeSurface(text_surface);
-				text_surface = nullptr;
-				TTF_CloseFont(font);
+				if (g->src.w > 0) {
+					SDL_Rect dst = { pen_x, rect.y, g->src.w, g->src.h };
+					SDL_RenderCopy(renderer, atlas->texture.get(), &g->src, &dst);
+					SNEK_PROFILE_DRAW_CALLS(1);
+				}
+				pen_x += g->advance;
 			}
 		}
 };
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+#include <iostream>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "asset_pack.h"
+#include "profiler.h"
+
+// hands out shared handles to textures so every png is decoded and uploaded only once no matter how many sprites use it.
+// a texture is destroyed as soon as its last handle goes away, so the number of live textures is always known
+
+typedef std::shared_ptr<SDL_Texture> TextureHandle;
+
+class TextureCache {
+	private:
+		struct Registry {
+			std::unordered_map<SDL_Texture*, size_t> live; // texture -> approximate size in bytes
+			size_t bytes = 0;
+			unsigned int generation = 0; // bumped by release_all() so handles that outlive it don't destroy a recycled pointer
+		};
+
+		std::shared_ptr<Registry> registry = std::make_shared<Registry>();
+		std::unordered_map<std::string, std::weak_ptr<SDL_Texture>> by_path;
+
+	public:
+		const AssetPack* pack = nullptr; // looked in before the loose files, if set
+
+		TextureCache() {};
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+
+		// returns the already loaded texture for path if anyone still holds it, otherwise loads it from the pack or disk
+		TextureHandle load(SDL_Renderer* renderer, const std::string& path) {
+			SNEK_PROFILE_ZONE("TextureCache::load");
+
+			auto found = by_path.find(path);
+			if (found != by_path.end()) {
+				if (TextureHandle cached = found->second.lock())
+					return cached;
+			}
+
+			if (pack != nullptr) {
+				if (SDL_Surface* image = pack->image(path))
+					return upload(renderer, path, image);
+			}
+
+			SDL_Texture* texture = IMG_LoadTexture(renderer, path.c_str());
+			if (texture == NULL) {
+				std::cerr << "failed to load texture \"" << path << "\", error: " << IMG_GetError() << std::endl;
+				return nullptr;
+			}
+
+			TextureHandle handle = adopt(texture);
+			by_path[path] = handle;
+			return handle;
+		}
+
+		// uploads an image that was decoded elsewhere (see AssetLoader) and caches it under path like load() would, frees the surface
+		TextureHandle upload(SDL_Renderer* renderer, const std::string& path, SDL_Surface* surface) {
+			SNEK_PROFILE_ZONE("TextureCache::upload");
+			if (surface == nullptr)
+				return nullptr;
+
+			SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+			SDL_FreeSurface(surface);
+			if (texture == NULL) {
+				std::cerr << "failed to upload texture \"" << path << "\", error: " << SDL_GetError() << std::endl;
+				return nullptr;
+			}
+
+			TextureHandle handle = adopt(texture);
+			by_path[path] = handle;
+			return handle;
+		}
+
+		// takes ownership of a texture that didn't come from a file (rendered text etc.) so it's counted and freed like the rest
+		TextureHandle adopt(SDL_Texture* texture) {
+			if (texture == nullptr)
+				return nullptr;
+
+			Uint32 format = 0;
+			int w = 0, h = 0;
+			SDL_QueryTexture(texture, &format, NULL, &w, &h);
+			size_t size = (size_t)w * h * SDL_BYTESPERPIXEL(format);
+
+			registry->live[texture] = size;
+			registry->bytes += size;
+
+			std::shared_ptr<Registry> reg = registry;
+			unsigned int generation = reg->generation;
+			return TextureHandle(texture, [reg, generation](SDL_Texture* t) {
+				if (reg->generation != generation)
+					return; // already freed by release_all()
+
+				auto it = reg->live.find(t);
+				if (it != reg->live.end()) {
+					reg->bytes -= it->second;
+					reg->live.erase(it);
+					SDL_DestroyTexture(t);
+				}
+			});
+		}
+
+		size_t texture_count() const {
+			return registry->live.size();
+		}
+
+		size_t texture_bytes() const {
+			return registry->bytes;
+		}
+
+		// frees every texture still alive, has to be called before the renderer that owns them is destroyed
+		void release_all() {
+			for (auto& entry : registry->live)
+				SDL_DestroyTexture(entry.first);
+
+			registry->live.clear();
+			registry->bytes = 0;
+			registry->generation++;
+			by_path.clear();
+		}
+};
\ No newline at end of file
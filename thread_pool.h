@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// a fixed set of worker threads that run parallel_for() jobs. the range is cut into chunks that are dealt out to
+// every thread's own queue up front, each thread takes chunks off the back of its queue and when it runs dry it
+// steals from the front of the others, so a thread that got slow chunks doesn't hold everyone up.
+// the thread calling parallel_for() works too and only returns once every chunk is done
+
+class ThreadPool {
+	private:
+		struct Range {
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		// owner takes from the back, thieves from the front. chunks are big enough that a lock per chunk doesn't matter
+		struct WorkQueue {
+			std::mutex mutex;
+			std::vector<Range> ranges;
+			size_t front = 0;
+
+			void clear_and_reserve(size_t count) {
+				std::lock_guard<std::mutex> lock(mutex);
+				ranges.clear();
+				ranges.reserve(count);
+				front = 0;
+			}
+
+			void push(Range range) {
+				std::lock_guard<std::mutex> lock(mutex);
+				ranges.push_back(range);
+			}
+
+			bool pop(Range& range) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (front == ranges.size())
+					return false;
+				range = ranges.back();
+				ranges.pop_back();
+				return true;
+			}
+
+			bool steal(Range& range) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (front == ranges.size())
+					return false;
+				range = ranges[front++];
+				return true;
+			}
+		};
+
+		std::vector<std::thread> threads;
+		std::vector<std::unique_ptr<WorkQueue>> queues; // queues[0] belongs to whoever calls parallel_for()
+
+		std::mutex job_mutex;
+		std::condition_variable job_ready;
+		uint64_t job_generation = 0;
+		bool stopping = false;
+
+		// the current job, a plain function pointer and context so starting one never allocates
+		void* job_context = nullptr;
+		void (*job_call)(void*, size_t, size_t) = nullptr;
+		std::atomic<size_t> chunks_left { 0 };
+
+		void worker_main(size_t index) {
+			uint64_t seen_generation = 0;
+
+			for (;;) {
+				{
+					std::unique_lock<std::mutex> lock(job_mutex);
+					job_ready.wait(lock, [&]() { return stopping || job_generation != seen_generation; });
+					if (stopping)
+						return;
+					seen_generation = job_generation;
+				}
+				run_chunks(index);
+			}
+		}
+
+		// works through its own queue and then steals until there's nothing left anywhere
+		void run_chunks(size_t index) {
+			Range range;
+
+			for (;;) {
+				bool found = queues[index]->pop(range);
+				for (size_t i = 1; !found && i < queues.size(); i++)
+					found = queues[(index + i) % queues.size()]->steal(range);
+				if (!found)
+					return;
+
+				job_call(job_context, range.begin, range.end);
+				chunks_left.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+
+	public:
+		// thread_count counts the calling thread, 0 means one per hardware thread
+		explicit ThreadPool(unsigned int thread_count = 0) {
+			if (thread_count == 0)
+				thread_count = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+
+			for (unsigned int i = 0; i < thread_count; i++)
+				queues.emplace_back(new WorkQueue());
+			for (unsigned int i = 1; i < thread_count; i++)
+				threads.emplace_back(&ThreadPool::worker_main, this, (size_t)i);
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(job_mutex);
+				stopping = true;
+			}
+			job_ready.notify_all();
+
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t thread_count() const {
+			return queues.size();
+		}
+
+		// calls body(first, last) for consecutive pieces of [begin, end) of about grain items each, on any thread.
+		// body has to be safe to run on several pieces at once
+		template <class Body>
+		void parallel_for(size_t begin, size_t end, size_t grain, Body&& body) {
+			if (begin >= end)
+				return;
+			if (grain == 0)
+				grain = 1;
+
+			size_t chunks = (end - begin + grain - 1) / grain;
+			if (queues.size() == 1 || chunks == 1) {
+				body(begin, end); // nothing to share
+				return;
+			}
+
+			job_context = (void*)&body;
+			job_call = [](void* context, size_t first, size_t last) {
+				(*(typename std::remove_reference<Body>::type*)context)(first, last);
+			};
+			chunks_left.store(chunks, std::memory_order_relaxed);
+
+			// deal the chunks out in contiguous runs, so neighbouring items mostly stay on one thread
+			size_t per_queue = (chunks + queues.size() - 1) / queues.size();
+			for (auto& queue : queues)
+				queue->clear_and_reserve(per_queue);
+			for (size_t chunk = 0; chunk < chunks; chunk++) {
+				size_t first = begin + chunk * grain;
+				size_t last = end - first > grain ? first + grain : end;
+				queues[chunk / per_queue]->push({ first, last });
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(job_mutex);
+				job_generation++;
+			}
+			job_ready.notify_all();
+
+			run_chunks(0);
+			while (chunks_left.load(std::memory_order_acquire) != 0)
+				std::this_thread::yield(); // someone is still on their last chunk
+		}
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// hands the newest copy of some state from one thread to another without either of them ever waiting. there are three
+// copies: the producer writes into its own, the consumer reads from its own, and publish() swaps the producer's with the
+// one in the middle, which update() then swaps with the consumer's. the consumer always gets the latest publish and the
+// ones it didn't get to are just overwritten. the middle index carries a bit that says whether it's newer than what the
+// consumer has.
+// the slot write_slot() returns still holds whatever was published into it two publishes ago, so the producer has to
+// set all of it, but it can keep buffers from last time instead of allocating them again
+
+template <class T>
+class TripleBuffer {
+	private:
+		static const uint8_t index_mask = 3;
+		static const uint8_t fresh = 4;
+
+		T slots[3];
+		uint8_t back = 0; // the producer's
+		alignas(64) std::atomic<uint8_t> middle { 1 };
+		alignas(64) uint8_t front = 2; // the consumer's
+
+	public:
+		TripleBuffer() {};
+
+		TripleBuffer(const TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		// producer only
+		T& write_slot() {
+			return slots[back];
+		}
+
+		// producer only, write_slot() is a different slot afterwards
+		void publish() {
+			back = middle.exchange(back | fresh, std::memory_order_acq_rel) & index_mask;
+		}
+
+		// consumer only, takes the newest published slot if there is one it hasn't seen yet
+		bool update() {
+			if (!(middle.load(std::memory_order_relaxed) & fresh))
+				return false;
+			front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+			return true;
+		}
+
+		// consumer only, stays the same until the next update()
+		const T& read() const {
+			return slots[front];
+		}
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "rng.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// a non-blocking ipv4 udp socket, just enough for the versus netcode. no SDL in here
+
+struct NetAddress {
+	uint32_t ip = 0; // host byte order
+	uint16_t port = 0;
+
+	bool operator==(const NetAddress& other) const {
+		return ip == other.ip && port == other.port;
+	}
+
+	// "host:port", the host can be a name or a dotted address
+	static bool parse(const char* text, NetAddress& address) {
+		const char* colon = strrchr(text, ':');
+		if (colon == nullptr || colon == text)
+			return false;
+
+		std::string host(text, colon - text);
+		int port = atoi(colon + 1);
+		if (port <= 0 || port > 65535)
+			return false;
+
+		addrinfo hints = {};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* found = nullptr;
+		if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+			return false;
+
+		address.ip = ntohl(((sockaddr_in*)found->ai_addr)->sin_addr.s_addr);
+		address.port = (uint16_t)port;
+		freeaddrinfo(found);
+		return true;
+	}
+
+	static NetAddress loopback(uint16_t port) {
+		NetAddress address;
+		address.ip = 0x7F000001; // 127.0.0.1
+		address.port = port;
+		return address;
+	}
+};
+
+class UdpSocket {
+	private:
+#ifdef _WIN32
+		SOCKET handle = INVALID_SOCKET;
+#else
+		int handle = -1;
+#endif
+
+		static sockaddr_in to_sockaddr(const NetAddress& address) {
+			sockaddr_in result = {};
+			result.sin_family = AF_INET;
+			result.sin_addr.s_addr = htonl(address.ip);
+			result.sin_port = htons(address.port);
+			return result;
+		}
+
+	public:
+		UdpSocket() {};
+
+		~UdpSocket() {
+			close();
+		}
+
+		UdpSocket(const UdpSocket&) = delete;
+		UdpSocket& operator=(const UdpSocket&) = delete;
+
+		// binds to the port on every interface, or only on loopback so tests don't show up on the network
+		bool open(uint16_t port, bool loopback_only = false) {
+			close();
+#ifdef _WIN32
+			WSADATA wsa;
+			if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+				return false;
+			handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (handle == INVALID_SOCKET) {
+				WSACleanup();
+				return false;
+			}
+			u_long non_blocking = 1;
+			ioctlsocket(handle, FIONBIO, &non_blocking);
+#else
+			handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (handle < 0)
+				return false;
+			fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+			sockaddr_in local = to_sockaddr(loopback_only ? NetAddress::loopback(port) : NetAddress { 0, port });
+			if (bind(handle, (const sockaddr*)&local, sizeof(local)) != 0) {
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		void close() {
+#ifdef _WIN32
+			if (handle != INVALID_SOCKET) {
+				closesocket(handle);
+				WSACleanup();
+			}
+			handle = INVALID_SOCKET;
+#else
+			if (handle >= 0)
+				::close(handle);
+			handle = -1;
+#endif
+		}
+
+		bool is_open() const {
+#ifdef _WIN32
+			return handle != INVALID_SOCKET;
+#else
+			return handle >= 0;
+#endif
+		}
+
+		bool send(const NetAddress& to, const uint8_t* data, size_t size) {
+			sockaddr_in address = to_sockaddr(to);
+			return sendto(handle, (const char*)data, (int)size, 0, (const sockaddr*)&address, sizeof(address)) == (int)size;
+		}
+
+		// the size of the next waiting packet, 0 if there's none. never blocks
+		size_t receive(uint8_t* buffer, size_t capacity, NetAddress& from) {
+			sockaddr_in address = {};
+			socklen_t address_length = sizeof(address);
+			int received = (int)recvfrom(handle, (char*)buffer, (int)capacity, 0, (sockaddr*)&address, &address_length);
+			if (received <= 0)
+				return 0;
+
+			from.ip = ntohl(address.sin_addr.s_addr);
+			from.port = ntohs(address.sin_port);
+			return (size_t)received;
+		}
+};
+
+// sits in front of a socket's sends and drops, delays and reorders packets on purpose, so a bad network can be
+// tried out on one machine over loopback. with everything at 0 packets go out right away
+class LossyLink {
+	private:
+		struct DelayedPacket {
+			uint64_t due_ms = 0;
+			NetAddress to;
+			uint8_t data[64];
+			size_t size = 0;
+		};
+
+		std::vector<DelayedPacket> delayed; // unordered, it's only ever a handful
+		Pcg32 rng;
+
+	public:
+		static const size_t max_packet = 64; // bigger packets skip the delay
+
+		double loss = 0.0; // share of packets dropped
+		uint32_t delay_ms = 0; // one way, so the round trip gets twice this
+		uint32_t jitter_ms = 0; // up to this much more delay, which also reorders packets
+
+		unsigned long long dropped = 0;
+
+		LossyLink() {};
+
+		void seed(uint64_t seed_value) {
+			rng.seed(seed_value, 0x4c4f5353); // its own stream so it doesn't line up with the game's
+		}
+
+		void send(UdpSocket& socket, const NetAddress& to, const uint8_t* data, size_t size, uint64_t now_ms) {
+			if (loss > 0.0 && rng.next() < loss * 4294967296.0) {
+				dropped++;
+				return;
+			}
+
+			uint64_t due = now_ms + delay_ms + (jitter_ms > 0 ? rng.bounded(jitter_ms + 1) : 0);
+			if (due <= now_ms || size > max_packet) {
+				socket.send(to, data, size);
+				return;
+			}
+
+			DelayedPacket packet;
+			packet.due_ms = due;
+			packet.to = to;
+			memcpy(packet.data, data, size);
+			packet.size = size;
+			delayed.push_back(packet);
+		}
+
+		// sends whatever is due, call it often
+		void pump(UdpSocket& socket, uint64_t now_ms) {
+			for (size_t i = 0; i < delayed.size();) {
+				if (delayed[i].due_ms <= now_ms) {
+					socket.send(delayed[i].to, delayed[i].data, delayed[i].size);
+					delayed[i] = delayed.back();
+					delayed.pop_back();
+				}
+				else
+					i++;
+			}
+		}
+};
\ No newline at end of file
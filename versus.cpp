@@ -0,0 +1,249 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "versus.h"
+#include "rollback.h"
+#include "udp_socket.h"
+
+// 2 to 8 player versus over udp with rollback netcode (see rollback.h), played by bots. without --player every peer runs
+// in this process and talks to the others over loopback sockets, with packets dropped and delayed on purpose, and the
+// run fails if the peers ever disagree about the game, e.g. "snek_versus --players 4 --rtt 150 --loss 5 --seconds 30".
+// with "--player <i> --peers <host:port>,<host:port>,..." (every player's address, its own included) it's one peer of
+// a game between processes or machines, each started with the same --peers, --board and --seed
+
+struct Peer {
+	RollbackSession session;
+	UdpSocket socket;
+	LossyLink link;
+	std::vector<NetAddress> addresses; // every player's, indexed by player
+	uint64_t next_frame_ms = 0;
+	Pcg32 bot_rng;
+};
+
+// shortest distance between two coordinates when the board wraps around
+static int wrapped_distance(int a, int b, int size) {
+	int d = abs(a - b);
+	return d < size - d ? d : size - d;
+}
+
+// right before a move: the free neighbour closest to the nearest food, and now and then a random free one so the bots
+// don't all play the same. the bot only sees the game with the guessed inputs, like a player would
+static VersusEngine::Input choose_input(const VersusEngine& engine, int player, Pcg32& rng) {
+	const VersusSnek& snek = engine.sneks[player];
+	if (!snek.alive || engine.pause > 0 || engine.frame % VersusEngine::move_frames != 0)
+		return VersusEngine::no_input;
+
+	const NodeDirection directions[] = { NodeDirection::UP, NodeDirection::DOWN, NodeDirection::LEFT, NodeDirection::RIGHT };
+	Cell head = snek.body.head();
+	bool wander = rng.bounded(8) == 0;
+
+	NodeDirection best = snek.direction;
+	int best_score = -(1 << 30);
+
+	for (NodeDirection dir : directions) {
+		if (dir == opposite(snek.direction))
+			continue;
+
+		Cell next = engine.neighbour_cell(head, dir);
+		int score = engine.occupancy.test(next) ? -(1 << 20) : 0;
+
+		if (wander)
+			score += (int)rng.bounded(100);
+		else {
+			int closest = 1 << 20;
+			for (Cell food : engine.foods) {
+				int distance = wrapped_distance(engine.cell_x(next), engine.cell_x(food), engine.board_width) + wrapped_distance(engine.cell_y(next), engine.cell_y(food), engine.board_height);
+				if (distance < closest)
+					closest = distance;
+			}
+			score -= closest;
+		}
+
+		if (score > best_score || (score == best_score && dir == snek.direction)) {
+			best_score = score;
+			best = dir;
+		}
+	}
+	return best != snek.direction ? (VersusEngine::Input)best : VersusEngine::no_input;
+}
+
+// takes in what arrived, plays the frames that are due and sends what's wanted
+static void run_peer(Peer& peer, uint64_t now_ms) {
+	uint8_t buffer[512];
+	NetAddress from;
+	size_t size;
+	while ((size = peer.socket.receive(buffer, sizeof(buffer), from)) > 0)
+		peer.session.read_packet(buffer, size);
+
+	for (int frames = 0; now_ms >= peer.next_frame_ms && frames < 5; frames++) { // a few at a time to catch up after a stall
+		if (peer.session.should_hold()) {
+			peer.next_frame_ms += VersusEngine::frame_ms;
+			continue;
+		}
+
+		int local = peer.session.local_player();
+		if (!peer.session.advance(choose_input(peer.session.engine(), local, peer.bot_rng)))
+			break; // waiting for a peer, try again once something arrived
+		peer.next_frame_ms += VersusEngine::frame_ms;
+	}
+
+	for (int p = 0; p < peer.session.player_count(); p++) {
+		if (peer.session.wants_to_send(p)) {
+			size = peer.session.write_packet(p, buffer);
+			peer.link.send(peer.socket, peer.addresses[p], buffer, size, now_ms);
+		}
+	}
+	peer.link.pump(peer.socket, now_ms);
+}
+
+static void print_stats(int player, const Peer& peer, double seconds) {
+	const RollbackStats& stats = peer.session.stats;
+	int peers = peer.session.player_count() - 1;
+	double per_second = 1.0 / (seconds > 0 ? seconds : 1e-9);
+
+	printf("player %d: %llu frames, %llu rollbacks (%.1f frames on average, longest %llu), %llu stalls, %llu frames held\n", player,
+		(unsigned long long)peer.session.current, stats.rollbacks, stats.rollbacks > 0 ? (double)stats.frames_resimulated / stats.rollbacks : 0.0,
+		stats.longest_rollback, stats.stalls, stats.frames_held);
+	printf("  sent %.1f packets/s, %.1f bytes/s (%.1f to each peer, %.1f with udp/ip headers), %llu dropped on purpose\n",
+		stats.packets_sent * per_second, stats.bytes_sent * per_second, stats.bytes_sent * per_second / peers,
+		(stats.bytes_sent + stats.packets_sent * 28) * per_second, peer.link.dropped);
+	printf("  checksums matched: %llu, desyncs: %llu", stats.checksums_matched, stats.desyncs);
+	if (stats.desyncs > 0)
+		printf(" (first at frame %llu)", (unsigned long long)stats.first_desync_frame);
+	printf(", bad packets: %llu\n", stats.bad_packets);
+}
+
+int main(int argc, char* argv[]) {
+	int players = 4;
+	int width = 40, height = 30;
+	uint64_t seed = 1;
+	double seconds = 10.0;
+	uint32_t rtt_ms = 150, jitter_ms = 0;
+	double loss_percent = 0.0;
+	int port = 47000;
+	int local_player = -1;
+	std::vector<NetAddress> addresses;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--players") == 0 && i + 1 < argc)
+			players = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rtt") == 0 && i + 1 < argc)
+			rtt_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+			jitter_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+			loss_percent = atof(argv[++i]);
+		else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			port = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--player") == 0 && i + 1 < argc)
+			local_player = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--peers") == 0 && i + 1 < argc) {
+			std::string list = argv[++i];
+			for (size_t start = 0; start <= list.size();) {
+				size_t comma = list.find(',', start);
+				std::string entry = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+				NetAddress address;
+				if (!NetAddress::parse(entry.c_str(), address)) {
+					std::cerr << "couldn't make sense of the address \"" << entry << "\", expected host:port" << std::endl;
+					return 1;
+				}
+				addresses.push_back(address);
+				if (comma == std::string::npos)
+					break;
+				start = comma + 1;
+			}
+		}
+		else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 8 || height < 4) {
+				std::cerr << "--board expects WIDTHxHEIGHT of at least 8x4, e.g. 40x30" << std::endl;
+				return 1;
+			}
+		}
+		else {
+			std::cerr << "unknown option \"" << argv[i] << "\"" << std::endl;
+			return 1;
+		}
+	}
+
+	bool networked = local_player >= 0;
+	if (networked)
+		players = (int)addresses.size();
+	if (players < 2 || players > VersusEngine::max_players || (networked && local_player >= players)) {
+		std::cerr << "versus needs 2 to " << VersusEngine::max_players << " players" << (networked ? ", one address per player in --peers and --player one of them" : "") << std::endl;
+		return 1;
+	}
+	if (!networked) {
+		for (int p = 0; p < players; p++)
+			addresses.push_back(NetAddress::loopback((uint16_t)(port + p)));
+	}
+
+	// the peers this process runs, all of them over loopback or just the local player
+	std::vector<std::unique_ptr<Peer>> peers;
+	for (int p = 0; p < players; p++) {
+		if (networked && p != local_player)
+			continue;
+
+		std::unique_ptr<Peer> peer(new Peer());
+		if (!peer->socket.open(addresses[p].port, !networked)) {
+			std::cerr << "couldn't open a udp socket on port " << addresses[p].port << std::endl;
+			return 1;
+		}
+		peer->session.start(players, p, width, height, seed);
+		peer->addresses = addresses;
+		peer->bot_rng.seed(seed, p + 1);
+		if (!networked) {
+			peer->link.seed(seed + p);
+			peer->link.delay_ms = rtt_ms / 2;
+			peer->link.jitter_ms = jitter_ms;
+			peer->link.loss = loss_percent / 100.0;
+		}
+		peers.push_back(std::move(peer));
+	}
+
+	std::cout << "board: " << width << "x" << height << ", players: " << players << ", seed: " << seed;
+	if (!networked)
+		std::cout << ", rtt: " << rtt_ms << " ms, jitter: " << jitter_ms << " ms, loss: " << loss_percent << "%";
+	std::cout << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+	uint64_t end_ms = (uint64_t)(seconds * 1000.0);
+	for (;;) {
+		uint64_t now_ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		if (now_ms >= end_ms)
+			break;
+
+		for (std::unique_ptr<Peer>& peer : peers)
+			run_peer(*peer, now_ms);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	bool in_sync = true;
+	for (std::unique_ptr<Peer>& peer : peers) {
+		print_stats(peer->session.local_player(), *peer, elapsed);
+		in_sync &= peer->session.stats.desyncs == 0 && peer->session.stats.checksums_matched > 0;
+	}
+
+	const VersusEngine& engine = peers[0]->session.engine();
+	printf("rounds: %u, wins:", engine.round);
+	for (const VersusSnek& snek : engine.sneks)
+		printf(" %u", snek.wins);
+	printf("\n");
+
+	if (!in_sync) {
+		std::cerr << "the peers didn't agree on the game (or never got to compare)" << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,237 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "snek.h"
+#include "board_layout.h"
+#include "occupancy.h"
+#include "rng.h"
+
+// 2 to 8 sneks playing against each other on one board, no SDL or networking in here.
+// everything only changes through step(), one call per frame with every player's input for that frame, so the same
+// seed and the same inputs always play out the same on every machine. that's what the rollback netcode in rollback.h
+// relies on: it keeps copies of this class to go back to and plays frames again once late inputs arrive. a copy
+// into an engine of the same size doesn't allocate, every buffer is sized in reset().
+//
+// rules: like the normal game the board wraps around and every snek moves one cell per move, here every move_frames
+// frames for everyone at once. a turn is taken on the snek's next move. moving into a cell that was taken at the start
+// of the move kills the snek and heads meeting in the same cell all die. the last snek alive wins the round and after
+// a short pause everyone starts again
+
+struct VersusSnek {
+	SnekBody body;
+	NodeDirection direction = NodeDirection::UP; // the way it last moved
+	NodeDirection next_direction = NodeDirection::UP; // the way it moves next
+	bool alive = false;
+	uint32_t length_to_grow = 0;
+	uint32_t score = 0; // food eaten this round
+	uint32_t wins = 0;
+};
+
+class VersusEngine {
+	private:
+		std::vector<Cell> targets; // per snek, where it moves this step
+		std::vector<uint8_t> dies; // per snek
+
+	public:
+		static const int max_players = 8;
+		static const uint32_t frame_ms = 20; // 50 frames a second
+		static const uint32_t move_frames = 5; // a move every 100 ms
+		static const uint32_t round_pause_frames = 75; // 1.5 s between rounds
+		static const size_t max_snek_length = 256;
+
+		// a player's input for a frame, 0 is no turn and anything else is a NodeDirection
+		typedef uint8_t Input;
+		static const Input no_input = 0;
+
+		int board_width = 0;
+		int board_height = 0;
+		DynamicBoardLayout layout; // the cells and which one is next to which, the same as the engine's
+		std::vector<VersusSnek> sneks;
+		OccupancyGrid occupancy; // every snek body
+		std::vector<Cell> foods; // one per player
+		Pcg32 rng;
+
+		uint64_t frame = 0; // frames stepped since reset()
+		uint32_t round = 0;
+		uint32_t pause = 0; // frames left until the next round starts, 0 while playing
+		int last_winner = -1; // -1 if nobody was left
+
+		VersusEngine() {};
+
+		void reset(int width, int height, int players, uint64_t seed) {
+			board_width = width;
+			board_height = height;
+			layout.resize(width, height);
+			rng.seed(seed);
+
+			sneks.resize(players);
+			for (VersusSnek& snek : sneks)
+				snek.wins = 0;
+			targets.assign(players, 0);
+			dies.assign(players, 0);
+			foods.assign(players, 0);
+
+			frame = 0;
+			round = 0;
+			last_winner = -1;
+			start_round();
+		}
+
+		// everyone back to length 1, spread out over the middle row and going up and down in turn
+		void start_round() {
+			occupancy.reset((size_t)board_width * board_height);
+
+			int players = (int)sneks.size();
+			for (int i = 0; i < players; i++) {
+				VersusSnek& snek = sneks[i];
+				Cell start = make_cell((i + 1) * board_width / (players + 1), board_height / 2);
+				snek.body.reset(max_snek_length, start);
+				snek.direction = i % 2 == 0 ? NodeDirection::UP : NodeDirection::DOWN;
+				snek.next_direction = snek.direction;
+				snek.alive = true;
+				snek.length_to_grow = 2;
+				snek.score = 0;
+				occupancy.set(start);
+			}
+
+			for (size_t slot = 0; slot < foods.size(); slot++)
+				foods[slot] = random_free_cell();
+
+			round++;
+			pause = 0;
+		}
+
+		// one frame, inputs has an entry per player
+		void step(const Input* inputs) {
+			if (pause > 0) {
+				if (--pause == 0)
+					start_round();
+				frame++;
+				return;
+			}
+
+			for (size_t i = 0; i < sneks.size(); i++) {
+				NodeDirection dir = (NodeDirection)inputs[i];
+				if (sneks[i].alive && inputs[i] != no_input && dir != opposite(sneks[i].direction))
+					sneks[i].next_direction = dir;
+			}
+
+			if (frame % move_frames == 0)
+				move_sneks();
+			frame++;
+		}
+
+		void move_sneks() {
+			// where everyone goes, and who runs into something that was there before the move or into another head
+			for (size_t i = 0; i < sneks.size(); i++) {
+				if (!sneks[i].alive)
+					continue;
+				sneks[i].direction = sneks[i].next_direction;
+				targets[i] = neighbour_cell(sneks[i].body.head(), sneks[i].direction);
+				dies[i] = occupancy.test(targets[i]);
+			}
+			for (size_t i = 0; i < sneks.size(); i++) {
+				for (size_t j = i + 1; j < sneks.size() && sneks[i].alive; j++) {
+					if (sneks[j].alive && targets[i] == targets[j])
+						dies[i] = dies[j] = 1;
+				}
+			}
+
+			for (size_t i = 0; i < sneks.size(); i++) {
+				VersusSnek& snek = sneks[i];
+				if (!snek.alive)
+					continue;
+
+				if (dies[i]) {
+					snek.alive = false;
+					for (size_t s = 0; s < snek.body.size(); s++)
+						occupancy.clear(snek.body.at(s));
+					continue;
+				}
+
+				if (snek.length_to_grow > 0 && !snek.body.full())
+					snek.length_to_grow--;
+				else {
+					Cell old_tail = snek.body.tail();
+					snek.body.pop_tail();
+					if (snek.body.size() == 0 || snek.body.tail() != old_tail)
+						occupancy.clear(old_tail);
+				}
+				snek.body.push_head(targets[i]);
+				occupancy.set(targets[i]);
+			}
+
+			for (size_t slot = 0; slot < foods.size(); slot++) {
+				for (VersusSnek& snek : sneks) {
+					if (snek.alive && snek.body.head() == foods[slot]) {
+						snek.score++;
+						snek.length_to_grow++;
+						foods[slot] = random_free_cell();
+						break;
+					}
+				}
+			}
+
+			int alive = 0, winner = -1;
+			for (size_t i = 0; i < sneks.size(); i++) {
+				if (sneks[i].alive) {
+					alive++;
+					winner = (int)i;
+				}
+			}
+			if (alive <= (sneks.size() > 1 ? 1 : 0)) {
+				last_winner = winner;
+				if (winner >= 0)
+					sneks[winner].wins++;
+				pause = round_pause_frames;
+			}
+		}
+
+		// a cell without a snek on it, food can end up on other food which is harmless
+		Cell random_free_cell() {
+			if (occupancy.free_count() == 0)
+				return 0;
+			return occupancy.nth_free(rng.bounded((uint32_t)occupancy.free_count()));
+		}
+
+		// a hash of everything step() looks at, peers compare these to find out they went out of sync
+		uint32_t checksum() const {
+			uint32_t hash = 0x811c9dc5u; // fnv-1a
+			auto mix = [&hash](uint32_t value) {
+				hash = (hash ^ value) * 0x01000193u;
+			};
+
+			mix((uint32_t)frame);
+			mix(round);
+			mix(pause);
+			for (const VersusSnek& snek : sneks) {
+				mix((uint32_t)snek.direction | (uint32_t)snek.next_direction << 4 | (uint32_t)snek.alive << 8);
+				mix(snek.length_to_grow);
+				mix(snek.score);
+				mix(snek.wins);
+				for (size_t i = 0; i < snek.body.size(); i++)
+					mix(snek.body.at(i));
+			}
+			for (Cell food : foods)
+				mix(food);
+			return hash;
+		}
+
+		Cell make_cell(int x, int y) const {
+			return layout.make_cell(x, y);
+		}
+
+		int cell_x(Cell cell) const {
+			return layout.cell_x(cell);
+		}
+
+		int cell_y(Cell cell) const {
+			return layout.cell_y(cell);
+		}
+
+		// the cell next to the given one, wrapping around the board edges
+		Cell neighbour_cell(Cell cell, NodeDirection dir) const {
+			return layout.neighbour_cell(cell, dir);
+		}
+};
\ No newline at end of file